@@ -329,15 +329,19 @@ proc ::MDFF::Check::mdff_check_cc { frames_begin frames_step frames_end } {
   set xlist {}
   set ylist {}  
   
+  # compute the whole time series at once
+  set frames "$frames_begin:$frames_step:$frames_end"
+  if $use_threshold {
+    set ylist [mdff ccc $sel -i $map -res $resolution -spacing $gridspacing -threshold $threshold -frames $frames]
+  } else {
+    set ylist [mdff ccc $sel -i $map -res $resolution -spacing $gridspacing -frames $frames]
+  }
+
+  set i 0
   for {set f $frames_begin} {$f <= $frames_end} {incr f $frames_step} {
-    $sel frame $f
-    if $use_threshold {
-      set ccc [mdff ccc $sel -i $map -res $resolution -spacing $gridspacing -threshold $threshold]
-    } else {
-      set ccc [mdff ccc $sel -i $map -res $resolution -spacing $gridspacing]
-    }
+    set ccc [lindex $ylist $i]
+    incr i
     lappend xlist $f
-    lappend ylist $ccc
     if { $ccfile != 0 } {
       puts $ccout "$f $ccc"
     }
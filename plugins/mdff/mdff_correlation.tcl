@@ -40,6 +40,8 @@ proc ::MDFF::Correlation::mdff_ccc_usage { } {
   puts "  -spacing <grid spacing in Angstroms> (default: $defaultGridspacing)"
   puts "  -threshold <x sigmas>"
   puts "  -allframes (average over all frames)"
+  puts "  -frames <begin:end> or <begin:step:end> or all or now"
+  puts "          (return the coefficient for each frame)"
   
 }
 
@@ -73,6 +75,7 @@ proc ::MDFF::Correlation::mdff_ccc { args } {
       -res { set arg(res) $val }
       -spacing { set arg(spacing) $val }
       -threshold { set arg(threshold) $val }
+      -frames { set arg(frames) $val }
     }
   }
 
@@ -101,6 +104,56 @@ proc ::MDFF::Correlation::mdff_ccc { args } {
     set use_threshold 0
   }
 
+  # Per-frame time series
+  if { [info exists arg(frames)] } {
+    if $allFrames {
+      error "Options -allframes and -frames are mutually exclusive."
+    }
+    set frames [::MDFF::Tmp::getFrames -molid [$sel molid] -frames $arg(frames)]
+    set frames_begin [lindex $frames 0]
+    set frames_step [lindex $frames 1]
+    set frames_end [lindex $frames 2]
+
+    if { [native_ccc_available] } {
+      return [mdff_ccc_native $sel $inputMap $res $spacing \
+                $use_threshold [expr {$use_threshold ? $threshold : 0}] \
+                $frames_begin $frames_step $frames_end]
+    }
+
+    set opts [list -i $inputMap -res $res -spacing $spacing]
+    if $use_threshold {
+      lappend opts -threshold $threshold
+    }
+    set oldframe [$sel frame]
+    set cclist {}
+    for {set f $frames_begin} {$f <= $frames_end} {incr f $frames_step} {
+      $sel frame $f
+      lappend cclist [eval mdff_ccc $sel $opts]
+    }
+    $sel frame $oldframe
+    return $cclist
+  }
+
+  # Correlate a single frame directly with the native engine
+  if { !$allFrames && [native_ccc_available] } {
+    set f [$sel frame]
+    if { $f == "now" } {
+      set f [molinfo [$sel molid] get frame]
+    } elseif { $f == "last" } {
+      set f [expr {[molinfo [$sel molid] get numframes] - 1}]
+    }
+    return [lindex [mdff_ccc_native $sel $inputMap $res $spacing \
+                      $use_threshold [expr {$use_threshold ? $threshold : 0}] \
+                      $f 1 $f] 0]
+  }
+
+  # Use VMD's built-in map operations when available; this avoids
+  # writing and re-reading temporary DX files and running volutil
+  if { [inprocess_available] } {
+    return [mdff_ccc_inprocess $sel $inputMap $res $spacing $allFrames \
+              $use_threshold [expr {$use_threshold ? $threshold : 0}]]
+  }
+
   # Get temporary filenames
   set tmpDir [::MDFF::Tmp::tmpdir]
   set tmpDX [file join $tmpDir \
@@ -147,3 +200,108 @@ proc ::MDFF::Correlation::mdff_ccc { args } {
 
 }
 
+
+# Return 1 if this VMD provides the in-process "volmap correlate" command
+proc ::MDFF::Correlation::inprocess_available { } {
+
+  variable inprocess
+  if { ![info exists inprocess] } {
+    catch {volmap} usage
+    set inprocess [string match "*volmap correlate*" $usage]
+  }
+  return $inprocess
+
+}
+
+
+# Return 1 if this VMD provides the native "volmap ccc" engine
+proc ::MDFF::Correlation::native_ccc_available { } {
+
+  variable nativeccc
+  if { ![info exists nativeccc] } {
+    catch {volmap} usage
+    set nativeccc [string match "*volmap ccc*" $usage]
+  }
+  return $nativeccc
+
+}
+
+
+# Compute the cross-correlation coefficient for frames first to last of
+# the selection with "volmap ccc", which simulates each frame over the
+# same region as "mdff sim" (the selection's bounding box plus the blur
+# margin, clipped to the target map) and doesn't write any files.
+# Returns the list of coefficients, one per frame.
+proc ::MDFF::Correlation::mdff_ccc_native { sel inputMap res spacing use_threshold threshold first step last } {
+
+  set weight [::MDFF::Tmp::getAtomicNumber $sel]
+
+  set oldtop [molinfo top]
+  set tmpmol [mol new $inputMap waitfor all]
+  mol off $tmpmol
+
+  set opts [list -res $res -spacing $spacing -weight $weight \
+              -first $first -last $last -step $step]
+  if $use_threshold {
+    lappend opts -threshold $threshold
+  }
+  set err [catch {eval volmap ccc $sel $tmpmol 0 $opts} msg]
+
+  mol delete $tmpmol
+  if { $oldtop >= 0 } {
+    mol top $oldtop
+  }
+
+  if $err {
+    error $msg
+  }
+
+  return $msg
+
+}
+
+
+# Compute the cross-correlation coefficient entirely within VMD: the
+# simulated map is built, blurred, and correlated in a scratch molecule,
+# using the same parameters as mdff sim and volutil -corr.
+proc ::MDFF::Correlation::mdff_ccc_inprocess { sel inputMap res spacing allFrames use_threshold threshold } {
+
+  set weight [::MDFF::Tmp::getAtomicNumber $sel]
+
+  set oldtop [molinfo top]
+  set tmpmol [mol new]
+  mol off $tmpmol
+
+  set err [catch {
+    if $allFrames {
+      volmap interp $sel -res $spacing -weight $weight -mol $tmpmol -allframes
+    } else {
+      volmap interp $sel -res $spacing -weight $weight -mol $tmpmol
+    }
+
+    # Low pass filter to the target resolution; as with volutil,
+    # sigma is pre-divided by sqrt(3) so we don't have to do it here
+    set sigma [expr {0.5 * $res}]
+    volmap smooth $tmpmol 0 $sigma -pad -mol $tmpmol
+
+    mol addfile $inputMap molid $tmpmol waitfor all
+
+    if $use_threshold {
+      set cc [volmap correlate $tmpmol 2 $tmpmol 1 -threshold $threshold]
+    } else {
+      set cc [volmap correlate $tmpmol 2 $tmpmol 1]
+    }
+  } msg]
+
+  mol delete $tmpmol
+  if { $oldtop >= 0 } {
+    mol top $oldtop
+  }
+
+  if $err {
+    error $msg
+  }
+
+  return $cc
+
+}
@@ -32,16 +32,17 @@ typedef struct hash_node_t {
  *  key: The key to create a hash number for
  */
 static int hash(hash_t *tptr, const char *key) {
-  int i=0;
+  unsigned int i=2166136261U;
   int hashvalue;
- 
+
+  /* FNV-1a, so that every character of long keys and numeric keys such
+     as residue ids contributes; the old shift-and-add only kept the last
+     ten characters and mapped e.g. "18" and "20" to the same value */
   while (*key != '\0')
-    i=(i<<3)+(*key++ - '0');
- 
-  hashvalue = (((i*1103515249)>>tptr->downshift) & tptr->mask);
-  if (hashvalue < 0) {
-    hashvalue = 0;
-  }    
+    i=(i ^ (unsigned char) *key++) * 16777619U;
+
+  /* take the high bits of the product, there are size buckets */
+  hashvalue = (int) (((i*1103515249U)>>tptr->downshift) & tptr->mask);
 
   return hashvalue;
 }
@@ -94,7 +95,7 @@ void hash_init(hash_t *tptr, int buckets) {
   tptr->entries=0;
   tptr->size=2;
   tptr->mask=1;
-  tptr->downshift=29;
+  tptr->downshift=31;
 
   /* ensure buckets is a power of 2 */
   while (tptr->size<buckets) {
@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #include "memarena.h"
 
+/* Blocks start at newblocksize and double each time one fills up, up to
+   this size, so small molecules stay small while large systems do not
+   need tens of thousands of separate mallocs. */
+#define MEMARENA_MAXBLOCKSIZE 8192000
+
 struct memarena_stack_t;
 typedef struct memarena_stack_t memarena_stack_t;
 struct memarena_stack_t {
@@ -73,6 +78,7 @@ void * memarena_alloc(memarena *a, int size) {
     a->stack = s;
     a->size = a->newblocksize;
     a->used = 0;
+    if ( a->newblocksize < MEMARENA_MAXBLOCKSIZE / 2 ) a->newblocksize *= 2;
   }
   m = (void*) ( (char*) a->stack->data + a->used );
   a->used += size;
@@ -228,6 +228,56 @@ void write_pdb_atom(FILE *outfile,
     float y, float z, float occ, float beta, char *chain, char *segname,
     char *element) {
 
+  char record[PDB_ATOM_BUFLEN];
+
+  format_pdb_atom(record,index,atomname,resname,resid,insertion,x,y,z,
+                  occ,beta,chain,segname,element);
+  fputs(record,outfile);
+}
+
+/* Same as sprintf(s,"%*.*f",width,prec,x) for prec 2 or 3, without a
+   printf call for every coordinate.  Scaling a float by 100 or 1000 is
+   exact in double precision, so it can be rounded like printf does, to
+   the nearest and ties to even; values that are not finite or too large
+   for that go through sprintf.  Returns the length. */
+static int format_pdb_fixed(char *s, float x, int width, int prec) {
+  char digits[32];
+  unsigned long n;
+  double v, f;
+  int i, len, neg;
+
+  if ( x != x || x >= 1.0e6f || x <= -1.0e6f ) {
+    return sprintf(s, "%*.*f", width, prec, x);
+  }
+  neg = ( x < 0.0f || ( x == 0.0f && 1.0 / x < 0.0 ) );
+  v = ( neg ? -x : x ) * ( prec == 2 ? 100.0 : 1000.0 );
+  n = (unsigned long) v;
+  f = v - n;
+  if ( f > 0.5 || ( f == 0.5 && ( n & 1 ) ) ) ++n;
+
+  len = 0;
+  for ( i=0; i<prec; ++i ) {
+    digits[len++] = '0' + n % 10;
+    n /= 10;
+  }
+  digits[len++] = '.';
+  do {
+    digits[len++] = '0' + n % 10;
+    n /= 10;
+  } while ( n );
+  if ( neg ) digits[len++] = '-';
+
+  for ( i=0; i < width - len; ++i ) s[i] = ' ';
+  while ( len ) s[i++] = digits[--len];
+  s[i] = '\0';
+  return i;
+}
+
+int format_pdb_atom(char *record,
+    int index,char *atomname,char *resname,int resid, char *insertion, float x,
+    float y, float z, float occ, float beta, char *chain, char *segname,
+    char *element) {
+
   char name[6];
   char chainc, insertionc;
   int p;
@@ -249,16 +299,21 @@ void write_pdb_atom(FILE *outfile,
   insertionc = ( insertion[0] ? insertion[0] : ' ' );
 
   if (index < 100000) {
-    fprintf(outfile,
-      "%s%5d %4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s\n",
+    p = sprintf(record, "%s%5d %4s%c%-4s%c%4d%c   ",
           "ATOM  ", index, atomname, ' ', resname, chainc, resid,
-          insertionc, x, y, z, occ, beta, segname, element);
+          insertionc);
   } else {
-    fprintf(outfile,
-      "%s***** %4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s\n",
+    p = sprintf(record, "%s***** %4s%c%-4s%c%4d%c   ",
           "ATOM  ", atomname, ' ', resname, chainc, resid,
-          insertionc, x, y, z, occ, beta, segname, element);
+          insertionc);
   }
+  p += format_pdb_fixed(record + p, x, 8, 3);
+  p += format_pdb_fixed(record + p, y, 8, 3);
+  p += format_pdb_fixed(record + p, z, 8, 3);
+  p += format_pdb_fixed(record + p, occ, 6, 2);
+  p += format_pdb_fixed(record + p, beta, 6, 2);
+  p += sprintf(record + p, "      %-4s%2s\n", segname, element);
+  return p;
 }
 
 
@@ -13,6 +13,9 @@
 
 #define PDB_RECORD_LENGTH	80
 
+/* enough for an atom record written with any coordinate values */
+#define PDB_ATOM_BUFLEN		256
+
 /*	record type defines	*/
 enum {PDB_REMARK, PDB_ATOM, PDB_UNKNOWN, PDB_END, PDB_EOF, PDB_CRYST1};
 
@@ -52,5 +55,13 @@ void write_pdb_atom(FILE *outfile,
     float y, float z, float occ, float beta, char *chain, char *segname,
     char *element);
 
+/* Format a pdb file atom record, with its newline, into record, which
+   must hold PDB_ATOM_BUFLEN characters; returns its length */
+
+int format_pdb_atom(char *record,
+    int index,char *atomname,char *resname,int resid, char *insertion, float x,
+    float y, float z, float occ, float beta, char *chain, char *segname,
+    char *element);
+
 #endif
 
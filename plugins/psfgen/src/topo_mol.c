@@ -1938,94 +1938,53 @@ int topo_mol_clear_xyz(topo_mol *mol, const topo_mol_ident_t *target) {
 }
 
 
-int topo_mol_guess_xyz(topo_mol *mol) {
-  char msg[128];
-  int iseg,nseg,ires,nres,ucount,i,nk,nu,gcount,gwild,okwild,wcount,hcount;
-  int ipass;
-  topo_mol_segment_t *seg;
-  topo_mol_residue_t *res;
-  topo_mol_atom_t *atom, *a1, *a2, *a3;
-  topo_mol_atom_t *ka[4];
-  topo_mol_atom_t *ua[4];
-  topo_mol_bond_t *bondtmp;
-  topo_mol_angle_t *angletmp;
-  double dihedral, angle234, dist34;
-  topo_mol_atom_t **uatoms;
-  topo_mol_conformation_t *conf;
-  double r12x,r12y,r12z,r12,r23x,r23y,r23z,r23,ix,iy,iz,jx,jy,jz,kx,ky,kz;
-  double tx,ty,tz,a,b,c;
-
-  if ( ! mol ) return -1;
-
-  ucount = 0;
-  hcount = 0;
-  nseg = hasharray_count(mol->segment_hash);
-  for ( iseg=0; iseg<nseg; ++iseg ) {
-    seg = mol->segment_array[iseg];
-    if (! seg) continue;
-    nres = hasharray_count(seg->residue_hash);
-    for ( ires=0; ires<nres; ++ires ) {
-      res = &(seg->residue_array[ires]);
-      for ( atom = res->atoms; atom; atom = atom->next ) {
-        if ( atom->xyz_state != TOPO_MOL_XYZ_SET ) {
-          ++ucount;
-          if ( atom->mass > 2.5 ) ++hcount;
-        }
-      }
-    }
-  }
-  sprintf(msg,"Info: guessing coordinates for %d atoms (%d non-hydrogen)",
-						ucount, hcount);
-  topo_mol_log_error(mol,msg);
-
-  uatoms = (topo_mol_atom_t**) malloc(ucount*sizeof(topo_mol_atom_t*));
-  if ( ! uatoms ) return -2;
-  ucount = 0;
-  nseg = hasharray_count(mol->segment_hash);
-  for ( iseg=0; iseg<nseg; ++iseg ) {
-    seg = mol->segment_array[iseg];
-    if (! seg) continue;
-    nres = hasharray_count(seg->residue_hash);
-    for ( ires=0; ires<nres; ++ires ) {
-      res = &(seg->residue_array[ires]);
-      for ( atom = res->atoms; atom; atom = atom->next ) {
-        if ( atom->xyz_state != TOPO_MOL_XYZ_SET ) uatoms[ucount++] = atom;
-      }
-    }
-  }
-
-  for ( i=0; i<ucount; ++i ) uatoms[i]->xyz_state = TOPO_MOL_XYZ_VOID;
-
-  /* everything below based on atom 4 unknown, all others known */
-
-  /* from the CHARMM docs:
-
-    Normal IC table entry:
-                I
-                 \
-                  \
-                   J----K
-                         \
-                          \
-                           L
-        values (Rij),(Tijk),(Pijkl),(Tjkl),(Rkl)
-
-    Improper type of IC table entry:
-                I        L
-                 \     /
-                  \   /
-                   *K
-                   |
-                   |
-                   J
-        values (Rik),(Tikj),(Pijkl),T(jkl),(Rkl)
-
-  */
+/* everything below based on atom 4 unknown, all others known */
+
+/* from the CHARMM docs:
+
+  Normal IC table entry:
+              I
+               \
+                \
+                 J----K
+                       \
+                        \
+                         L
+      values (Rij),(Tijk),(Pijkl),(Tjkl),(Rkl)
+
+  Improper type of IC table entry:
+              I        L
+               \     /
+                \   /
+                 *K
+                 |
+                 |
+                 J
+      values (Rik),(Tikj),(Pijkl),T(jkl),(Rkl)
+
+*/
 
 #ifndef M_PI
 #define M_PI            3.14159265358979323846
 #endif
 
+/*
+ * Guess coordinates from conformations for the unknown atoms in uatoms,
+ * in repeated passes until no more can be placed, then allowing wild
+ * guesses.  Only reads atoms that share conformations with uatoms, so
+ * groups of atoms which share none can be handled concurrently.  Counts
+ * the wild guesses, and those which are not hydrogens, in wcountp and
+ * hcountp.
+ */
+static void topo_mol_guess_conformations(topo_mol_atom_t **uatoms,
+                        int ucount, int *wcountp, int *hcountp) {
+  int i,gcount,gwild,okwild,wcount,hcount;
+  topo_mol_atom_t *atom, *a1, *a2, *a3;
+  topo_mol_conformation_t *conf;
+  double dihedral, angle234, dist34;
+  double r12x,r12y,r12z,r23x,r23y,r23z,ix,iy,iz,jx,jy,jz,kx,ky,kz;
+  double tx,ty,tz,a,b,c;
+
   gcount = 1;
   okwild = 0;
   wcount = 0;
@@ -2123,6 +2082,154 @@ int topo_mol_guess_xyz(topo_mol *mol) {
    }
   }
 
+
+  *wcountp = wcount;
+  *hcountp = hcount;
+}
+
+/* union of segment groups, kept rooted at their first segment */
+static int guess_group_find(int *root, int i) {
+  while ( root[i] != i ) {
+    root[i] = root[root[i]];
+    i = root[i];
+  }
+  return i;
+}
+
+static void guess_group_join(int *root, int i, int j) {
+  i = guess_group_find(root, i);
+  j = guess_group_find(root, j);
+  if ( i < j ) root[j] = i;
+  else if ( j < i ) root[i] = j;
+}
+
+int topo_mol_guess_xyz(topo_mol *mol) {
+  char msg[128];
+  int iseg,nseg,ires,nres,ucount,i,k,nk,nu,gcount,wcount,hcount;
+  int ipass,igroup,ngroup;
+  int *segstart, *segroot, *segnext, *groupstart, *groupend;
+  topo_mol_segment_t *seg;
+  topo_mol_residue_t *res;
+  topo_mol_atom_t *atom, *a1, *a2, *a3;
+  topo_mol_atom_t *ka[4];
+  topo_mol_atom_t *ua[4];
+  topo_mol_bond_t *bondtmp;
+  topo_mol_angle_t *angletmp;
+  double angle234;
+  topo_mol_atom_t **uatoms, **gatoms;
+  topo_mol_conformation_t *conf;
+  double r12x,r12y,r12z,r12,r23x,r23y,r23z,r23,ix,iy,iz,jx,jy,jz,kx,ky,kz;
+  double a,b,c;
+
+  if ( ! mol ) return -1;
+
+  ucount = 0;
+  hcount = 0;
+  nseg = hasharray_count(mol->segment_hash);
+  for ( iseg=0; iseg<nseg; ++iseg ) {
+    seg = mol->segment_array[iseg];
+    if (! seg) continue;
+    nres = hasharray_count(seg->residue_hash);
+    for ( ires=0; ires<nres; ++ires ) {
+      res = &(seg->residue_array[ires]);
+      for ( atom = res->atoms; atom; atom = atom->next ) {
+        if ( atom->xyz_state != TOPO_MOL_XYZ_SET ) {
+          ++ucount;
+          if ( atom->mass > 2.5 ) ++hcount;
+        }
+      }
+    }
+  }
+  sprintf(msg,"Info: guessing coordinates for %d atoms (%d non-hydrogen)",
+						ucount, hcount);
+  topo_mol_log_error(mol,msg);
+
+  uatoms = (topo_mol_atom_t**) malloc((2*ucount+1)*sizeof(topo_mol_atom_t*));
+  segstart = (int*) malloc(5*(nseg+1)*sizeof(int));
+  if ( ! uatoms || ! segstart ) {
+    free((void*)uatoms);
+    free((void*)segstart);
+    return -2;
+  }
+  gatoms = uatoms + ucount;
+  segroot = segstart + nseg + 1;
+  segnext = segroot + nseg + 1;
+  groupstart = segnext + nseg + 1;
+  groupend = groupstart + nseg + 1;
+
+  /* the atomid field holds the segment of each atom here */
+  ucount = 0;
+  for ( iseg=0; iseg<nseg; ++iseg ) {
+    segstart[iseg] = ucount;
+    seg = mol->segment_array[iseg];
+    if (! seg) continue;
+    nres = hasharray_count(seg->residue_hash);
+    for ( ires=0; ires<nres; ++ires ) {
+      res = &(seg->residue_array[ires]);
+      for ( atom = res->atoms; atom; atom = atom->next ) {
+        atom->atomid = iseg;
+        if ( atom->xyz_state != TOPO_MOL_XYZ_SET ) uatoms[ucount++] = atom;
+      }
+    }
+  }
+  segstart[nseg] = ucount;
+
+  for ( i=0; i<ucount; ++i ) uatoms[i]->xyz_state = TOPO_MOL_XYZ_VOID;
+
+  /* Segments are gathered into groups which share no conformations with
+     unknown atoms in other groups, as patches may link segments, and the
+     groups are guessed concurrently.  Each keeps the original order of
+     its atoms, so the coordinates are the same as guessing all at once. */
+  for ( iseg=0; iseg<nseg; ++iseg ) segroot[iseg] = iseg;
+  for ( i=0; i<ucount; ++i ) { atom = uatoms[i];
+    for ( conf = atom->conformations; conf;
+		conf = topo_mol_conformation_next(conf,atom) ) {
+      if ( conf->del ) continue;
+      for ( k=0; k<4; ++k ) {
+        a1 = conf->atom[k];
+        if ( a1->xyz_state == TOPO_MOL_XYZ_VOID &&
+             a1->atomid != atom->atomid ) {
+          guess_group_join(segroot, a1->atomid, atom->atomid);
+        }
+      }
+    }
+  }
+  for ( iseg=0; iseg<nseg; ++iseg ) segnext[iseg] = 0;
+  for ( iseg=0; iseg<nseg; ++iseg ) {
+    segroot[iseg] = guess_group_find(segroot, iseg);
+    segnext[segroot[iseg]] += segstart[iseg+1] - segstart[iseg];
+  }
+  ngroup = 0;
+  k = 0;
+  for ( iseg=0; iseg<nseg; ++iseg ) {
+    if ( segroot[iseg] != iseg || ! segnext[iseg] ) continue;
+    groupstart[ngroup] = k;
+    k += segnext[iseg];
+    groupend[ngroup] = k;
+    segnext[iseg] = groupstart[ngroup];  /* next free slot of the group */
+    ++ngroup;
+  }
+  for ( iseg=0; iseg<nseg; ++iseg ) {
+    for ( i=segstart[iseg]; i<segstart[iseg+1]; ++i ) {
+      gatoms[segnext[segroot[iseg]]++] = uatoms[i];
+    }
+  }
+
+  gcount = 0;
+  wcount = 0;
+  hcount = 0;
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:wcount,hcount) schedule(dynamic)
+#endif
+  for ( igroup=0; igroup<ngroup; ++igroup ) {
+    int gw, gh;
+    topo_mol_guess_conformations(gatoms + groupstart[igroup],
+                groupend[igroup] - groupstart[igroup], &gw, &gh);
+    wcount += gw;
+    hcount += gh;
+  }
+  free((void*)segstart);
+
   /* look for bad angles due to swapped atom names */
   for ( i=0; i<ucount; ++i ) { atom = uatoms[i];
     /* only look for errors in guessed atoms */
@@ -1,10 +1,80 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include "topo_mol_output.h"
 #include "topo_mol_struct.h"
 #include "pdb_file.h"
 
+/*
+ * Records are formatted into a large buffer which is written out with
+ * fwrite when full, and atom ids are converted without going through
+ * printf, since one fprintf call per atom and per bonded term dominated
+ * the time to write systems of millions of atoms.
+ */
+
+#define OUTBUF_SIZE 1048576
+#define OUTBUF_RECORD 512  /* room reserved for any one record */
+
+typedef struct topo_mol_outbuf_t {
+  FILE *file;
+  char *buf;
+  int used;
+} topo_mol_outbuf_t;
+
+static int outbuf_init(topo_mol_outbuf_t *ob, FILE *file) {
+  ob->file = file;
+  ob->used = 0;
+  ob->buf = (char*) malloc(OUTBUF_SIZE);
+  return ( ob->buf ? 0 : -1 );
+}
+
+static void outbuf_flush(topo_mol_outbuf_t *ob) {
+  if ( ob->used ) fwrite(ob->buf, 1, ob->used, ob->file);
+  ob->used = 0;
+}
+
+static void outbuf_destroy(topo_mol_outbuf_t *ob) {
+  outbuf_flush(ob);
+  free((void*)ob->buf);
+  ob->buf = 0;
+}
+
+/* space for a record of up to OUTBUF_RECORD characters */
+static char * outbuf_record(topo_mol_outbuf_t *ob) {
+  if ( ob->used + OUTBUF_RECORD > OUTBUF_SIZE ) outbuf_flush(ob);
+  return ob->buf + ob->used;
+}
+
+static void outbuf_printf(topo_mol_outbuf_t *ob, const char *fmt, ...) {
+  va_list ap;
+  char *rec;
+  rec = outbuf_record(ob);
+  va_start(ap, fmt);
+  ob->used += vsprintf(rec, fmt, ap);
+  va_end(ap);
+}
+
+/* same as printf(" %7d",id) */
+static void outbuf_atomid(topo_mol_outbuf_t *ob, int id) {
+  char digits[12];
+  char *rec;
+  unsigned int u;
+  int n, width;
+  u = ( id < 0 ? -(unsigned int)id : (unsigned int)id );
+  n = 0;
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while ( u );
+  if ( id < 0 ) digits[n++] = '-';
+  rec = outbuf_record(ob);
+  *(rec++) = ' ';
+  for ( width = n; width < 7; ++width ) *(rec++) = ' ';
+  while ( n ) *(rec++) = digits[--n];
+  ob->used = rec - ob->buf;
+}
+
 int topo_mol_write_pdb(topo_mol *mol, FILE *file, void *v, 
                                 void (*print_msg)(void *, const char *)) {
 
@@ -15,11 +85,18 @@ int topo_mol_write_pdb(topo_mol *mol, FILE *file, void *v,
   topo_mol_segment_t *seg;
   topo_mol_residue_t *res;
   topo_mol_atom_t *atom;
+  topo_mol_outbuf_t ob;
+  char *rec;
 
   if ( ! mol ) return -1;
 
   write_pdb_remark(file,"original generated coordinate pdb file");
 
+  if ( outbuf_init(&ob,file) ) {
+    print_msg(v,"ERROR: Unable to allocate output buffer.");
+    return -2;
+  }
+
   atomid = 0;
   nseg = hasharray_count(mol->segment_hash);
   for ( iseg=0; iseg<nseg; ++iseg ) {
@@ -58,13 +135,15 @@ int topo_mol_write_pdb(topo_mol *mol, FILE *file, void *v,
           break;
         }
         b = atom->partition;
-        write_pdb_atom(file,atomid,atom->name,res->name,atoi(res->resid),
-		"",(float)x,(float)y,(float)z,(float)o,(float)b,res->chain,
-		seg->segid,atom->element);
+        rec = outbuf_record(&ob);
+        ob.used += format_pdb_atom(rec,atomid,atom->name,res->name,
+		atoi(res->resid),"",(float)x,(float)y,(float)z,(float)o,
+		(float)b,res->chain,seg->segid,atom->element);
       }
     }
   }
 
+  outbuf_destroy(&ob);
   write_pdb_end(file);
   if (has_guessed_atoms) {
     print_msg(v, 
@@ -100,6 +179,7 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
   fpos_t ntitle_pos, save_pos;
   const char *ntitle_fmt;
   int ntitle_count;
+  topo_mol_outbuf_t ob;
   strcpy(defpatch,"");
 
   if ( ! mol ) return -1;
@@ -251,7 +331,12 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
   fprintf(file,ntitle_fmt,ntitle_count);
   fsetpos(file,&save_pos);
 
-  fprintf(file,"%8d !NATOM\n",atomid);
+  if ( outbuf_init(&ob,file) ) {
+    print_msg(v,"ERROR: Unable to allocate output buffer.");
+    return -4;
+  }
+
+  outbuf_printf(&ob,"%8d !NATOM\n",atomid);
   for ( iseg=0; iseg<nseg; ++iseg ) {
     seg = mol->segment_array[iseg];
     if (! seg) continue;
@@ -264,22 +349,25 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
         if ( idef == HASHARRAY_FAIL ) {
           sprintf(buf,"unknown atom type %s",atom->type);
           print_msg(v,buf);
+          outbuf_destroy(&ob);
           return -3;
         }
         typeid = mol->defs->type_array[idef].id;
-        fprintf(file,"%8d %-4s %-4s %-4s %-4s %4d %10.6f     %9.4f  %10d\n",
+        outbuf_printf(&ob,
+                "%8d %-4s %-4s %-4s %-4s %4d %10.6f     %9.4f  %10d\n",
                 atom->atomid, seg->segid,res->resid,res->name,
                 atom->name,typeid,atom->charge,atom->mass,0);
       } else for ( atom = res->atoms; atom; atom = atom->next ) {
-        fprintf(file,"%8d %-4s %-4s %-4s %-4s %-4s %10.6f     %9.4f  %10d\n",
+        outbuf_printf(&ob,
+                "%8d %-4s %-4s %-4s %-4s %-4s %10.6f     %9.4f  %10d\n",
                 atom->atomid, seg->segid,res->resid,res->name,
                 atom->name,atom->type,atom->charge,atom->mass,0);
       }
     }
   }
-  fprintf(file,"\n");
+  outbuf_printf(&ob,"\n");
 
-  fprintf(file,"%8d !NBOND: bonds\n",nbonds);
+  outbuf_printf(&ob,"%8d !NBOND: bonds\n",nbonds);
   numinline = 0;
   for ( iseg=0; iseg<nseg; ++iseg ) {
     seg = mol->segment_array[iseg];
@@ -291,17 +379,18 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
         for ( bond = atom->bonds; bond;
                 bond = topo_mol_bond_next(bond,atom) ) {
           if ( bond->atom[0] == atom && ! bond->del ) {
-            if ( numinline == 4 ) { fprintf(file,"\n");  numinline = 0; }
-            fprintf(file," %7d %7d",atom->atomid,bond->atom[1]->atomid);
+            if ( numinline == 4 ) { outbuf_printf(&ob,"\n");  numinline = 0; }
+            outbuf_atomid(&ob,atom->atomid);
+            outbuf_atomid(&ob,bond->atom[1]->atomid);
             ++numinline;
           }
         }
       }
     }
   }
-  fprintf(file,"\n\n");
+  outbuf_printf(&ob,"\n\n");
 
-  fprintf(file,"%8d !NTHETA: angles\n",nangls);
+  outbuf_printf(&ob,"%8d !NTHETA: angles\n",nangls);
   numinline = 0;
   for ( iseg=0; iseg<nseg; ++iseg ) {
     seg = mol->segment_array[iseg];
@@ -313,18 +402,19 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
         for ( angl = atom->angles; angl;
                 angl = topo_mol_angle_next(angl,atom) ) {
           if ( angl->atom[0] == atom && ! angl->del ) {
-            if ( numinline == 3 ) { fprintf(file,"\n");  numinline = 0; }
-            fprintf(file," %7d %7d %7d",atom->atomid,
-                angl->atom[1]->atomid,angl->atom[2]->atomid);
+            if ( numinline == 3 ) { outbuf_printf(&ob,"\n");  numinline = 0; }
+            outbuf_atomid(&ob,atom->atomid);
+            outbuf_atomid(&ob,angl->atom[1]->atomid);
+            outbuf_atomid(&ob,angl->atom[2]->atomid);
             ++numinline;
           }
         }
       }
     }
   }
-  fprintf(file,"\n\n");
+  outbuf_printf(&ob,"\n\n");
 
-  fprintf(file,"%8d !NPHI: dihedrals\n",ndihes);
+  outbuf_printf(&ob,"%8d !NPHI: dihedrals\n",ndihes);
   numinline = 0;
   for ( iseg=0; iseg<nseg; ++iseg ) {
     seg = mol->segment_array[iseg];
@@ -336,19 +426,20 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
         for ( dihe = atom->dihedrals; dihe;
                 dihe = topo_mol_dihedral_next(dihe,atom) ) {
           if ( dihe->atom[0] == atom && ! dihe->del ) {
-            if ( numinline == 2 ) { fprintf(file,"\n");  numinline = 0; }
-            fprintf(file," %7d %7d %7d %7d",atom->atomid,
-                dihe->atom[1]->atomid,dihe->atom[2]->atomid,
-                dihe->atom[3]->atomid);
+            if ( numinline == 2 ) { outbuf_printf(&ob,"\n");  numinline = 0; }
+            outbuf_atomid(&ob,atom->atomid);
+            outbuf_atomid(&ob,dihe->atom[1]->atomid);
+            outbuf_atomid(&ob,dihe->atom[2]->atomid);
+            outbuf_atomid(&ob,dihe->atom[3]->atomid);
             ++numinline;
           }
         }
       }
     }
   }
-  fprintf(file,"\n\n");
+  outbuf_printf(&ob,"\n\n");
 
-  fprintf(file,"%8d !NIMPHI: impropers\n",nimprs);
+  outbuf_printf(&ob,"%8d !NIMPHI: impropers\n",nimprs);
   numinline = 0;
   for ( iseg=0; iseg<nseg; ++iseg ) {
     seg = mol->segment_array[iseg];
@@ -360,36 +451,38 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
         for ( impr = atom->impropers; impr;
                 impr = topo_mol_improper_next(impr,atom) ) {
           if ( impr->atom[0] == atom && ! impr->del ) {
-            if ( numinline == 2 ) { fprintf(file,"\n");  numinline = 0; }
-            fprintf(file," %7d %7d %7d %7d",atom->atomid,
-                impr->atom[1]->atomid,impr->atom[2]->atomid,
-                impr->atom[3]->atomid);
+            if ( numinline == 2 ) { outbuf_printf(&ob,"\n");  numinline = 0; }
+            outbuf_atomid(&ob,atom->atomid);
+            outbuf_atomid(&ob,impr->atom[1]->atomid);
+            outbuf_atomid(&ob,impr->atom[2]->atomid);
+            outbuf_atomid(&ob,impr->atom[3]->atomid);
             ++numinline;
           }
         }
       }
     }
   }
-  fprintf(file,"\n\n");
+  outbuf_printf(&ob,"\n\n");
 
-  fprintf(file,"%8d !NDON: donors\n\n\n",0);
-  fprintf(file,"%8d !NACC: acceptors\n\n\n",0);
-  fprintf(file,"%8d !NNB\n\n",0);
+  outbuf_printf(&ob,"%8d !NDON: donors\n\n\n",0);
+  outbuf_printf(&ob,"%8d !NACC: acceptors\n\n\n",0);
+  outbuf_printf(&ob,"%8d !NNB\n\n",0);
   /* Pad with zeros, one for every atom */
   {
     int i, fullrows;
     fullrows = atomid/8;
     for (i=0; i<fullrows; ++i) 
-      fprintf(file, "%8d%8d%8d%8d%8d%8d%8d%8d\n",0,0,0,0,0,0,0,0);
+      outbuf_printf(&ob,
+        "       0       0       0       0       0       0       0       0\n");
     for (i=atomid - fullrows*8; i; --i)
-      fprintf(file, "%8d",0);
+      outbuf_printf(&ob,"       0");
   } 
-  fprintf(file,"\n\n");
+  outbuf_printf(&ob,"\n\n");
 
-  fprintf(file,"%8d %7d !NGRP\n%8d%8d%8d\n\n",1,0,0,0,0);
+  outbuf_printf(&ob,"%8d %7d !NGRP\n%8d%8d%8d\n\n",1,0,0,0,0);
 
   if ( ! nocmap ) {
-    fprintf(file,"%8d !NCRTERM: cross-terms\n",ncmaps);
+    outbuf_printf(&ob,"%8d !NCRTERM: cross-terms\n",ncmaps);
     for ( iseg=0; iseg<nseg; ++iseg ) {
       seg = mol->segment_array[iseg];
       if (! seg) continue;
@@ -400,19 +493,19 @@ int topo_mol_write_psf(topo_mol *mol, FILE *file, int charmmfmt, int nocmap,
           for ( cmap = atom->cmaps; cmap;
                   cmap = topo_mol_cmap_next(cmap,atom) ) {
             if ( cmap->atom[0] == atom && ! cmap->del ) {
-              fprintf(file," %7d %7d %7d %7d %7d %7d %7d %7d\n",atom->atomid,
-                  cmap->atom[1]->atomid,cmap->atom[2]->atomid,
-                  cmap->atom[3]->atomid,cmap->atom[4]->atomid,
-                  cmap->atom[5]->atomid,cmap->atom[6]->atomid,
-                  cmap->atom[7]->atomid);
+              int j;
+              outbuf_atomid(&ob,atom->atomid);
+              for ( j=1; j<8; ++j ) outbuf_atomid(&ob,cmap->atom[j]->atomid);
+              outbuf_printf(&ob,"\n");
             }
           }
         }
       }
     }
-    fprintf(file,"\n");
+    outbuf_printf(&ob,"\n");
   }
 
+  outbuf_destroy(&ob);
   return 0;
 }
 
@@ -4702,35 +4702,51 @@ proc ::timeline::writeDataFile {filename} {
     set progressCalcFraction [expr 1.0 - $progressDrawFraction] 
     set calcCount 0
 
-    for {set trajFrame $firstAnalysisFrame} {$trajFrame < $lastAnalysisFrame} {incr  trajFrame} {
-      animate goto $trajFrame 
-      display update ui
-      $sel frame $trajFrame
-      #puts "set frame to $trajFrame"
+    # compute all frames in one call if this VMD can, otherwise step
+    # through the trajectory and recalculate each frame
+    set lastFrame [expr $lastAnalysisFrame - 1]
+    if {![catch {mol ssframes $currentMol $firstAnalysisFrame $lastFrame} ssframes]} {
+      set residues [$sel get residue]
+      set trajFrame $firstAnalysisFrame
+      foreach frameStruct $ssframes {
+        set i 0
+        foreach res $residues {
+          set dataVal([expr $dataOrigin+$trajFrame],$i) [string index $frameStruct $res]
+          incr i
+        }
+        incr trajFrame
+      }
+    } else {
+      for {set trajFrame $firstAnalysisFrame} {$trajFrame < $lastAnalysisFrame} {incr  trajFrame} {
+        animate goto $trajFrame 
+        display update ui
+        $sel frame $trajFrame
+        #puts "set frame to $trajFrame"
       
-      #puts "now update for mol $currentMol"
-      mol ssrecalc $currentMol
-      #puts "updated"
-      set structlist [$sel get structure]
-      #puts "setting dataName([$dataOrigin+$trajFrame]) to struct..."
+        #puts "now update for mol $currentMol"
+        mol ssrecalc $currentMol
+        #puts "updated"
+        set structlist [$sel get structure]
+        #puts "setting dataName([$dataOrigin+$trajFrame]) to struct..."
 
-      set i 0
-      foreach elem $structlist {
-        set dataVal([expr $dataOrigin+$trajFrame],$i) $elem
-        incr i
+        set i 0
+        foreach elem $structlist {
+          set dataVal([expr $dataOrigin+$trajFrame],$i) $elem
+          incr i
         
-        if {$progressCancelPressed} break 
-      }
+          if {$progressCancelPressed} break 
+        }
  
-      unset structlist; #done with it
-      if {$progressBoxExists} {
-          set completeFrac [expr $progressCalcFraction * double($calcCount)/$calcCountTotal]
-          progressBoxConfigure [expr $completeFrac]
-       }
+        unset structlist; #done with it
+        if {$progressBoxExists} {
+            set completeFrac [expr $progressCalcFraction * double($calcCount)/$calcCountTotal]
+            progressBoxConfigure [expr $completeFrac]
+         }
      
-      if {$progressCancelPressed} break 
+        if {$progressCancelPressed} break 
 
-      incr calcCount
+        incr calcCount
+      }
     }
     if {$progressCancelPressed} {
         tlPutsDebug "progressCancelPressed" 
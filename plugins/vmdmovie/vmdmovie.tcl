@@ -816,6 +816,11 @@ proc ::MovieMaker::buildmovie {} {
         genframes_rockandroll      ;# Generate frames from VMD 
       }
     }
+
+    ;# frames may still be rendering in the background
+    if {$renderer == "libtachyon"} {
+      render wait TachyonInternal
+    }
   }
 
   if {$renderer == "dryrun"} {
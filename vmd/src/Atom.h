@@ -26,9 +26,6 @@
 #include <stdlib.h>
 #include "utilities.h"
 
-// maximum number of bonds allowed to other atoms
-#define MAXATOMBONDS      12
-
 // Atom type flags
 #define ATOMNORMAL      0
 #define ATOMPROTEINBACK 1
@@ -48,21 +45,22 @@ struct MolAtom {
  
   // items that make this particular atom unique and are absolutely 
   // needed to link it up to the rest of the structure, or are speed-critical
-  short nameindex;              ///< atom name string index
-  short typeindex;              ///< atom type string index
+  int *bondTo;                  ///< list of atoms to which this atom is bonded,
+                                ///< stored in the bond list of the molecule
+  int bonds;                    ///< how many bonds this atom has
   int uniq_resid;               ///< unique resid, since there can be dups
-  int bondTo[MAXATOMBONDS];     ///< list of atoms to which this atom is bonded
-  signed char bonds;            ///< how many bonds this atom has
+  int nameindex;                ///< atom name string index
+  int typeindex;                ///< atom type string index
   signed char atomicnumber;     ///< element atomic number
   signed char altlocindex;      ///< alternate location identifier index
   char insertionstr[2];         ///< for insertion codes (padded to 2 chars)
 
   // items which could potentially be moved into other data structures 
   // to save memory, but are presently kept here for extra simplicity or speed
-  signed char chainindex;       ///< chain identifier
-  short segnameindex;           ///< atom segment name string index
   int resid;                    ///< resid from original file
-  short resnameindex;           ///< atom residue name string index
+  int segnameindex;             ///< atom segment name string index
+  int resnameindex;             ///< atom residue name string index
+  signed char chainindex;       ///< chain identifier
 
   // ATOMNORMAL, ATOMPROTEINBACK, ATOMNUCLEICBACK, ATOMHYDROGEN
   // XXX this should be converted to an unsigned bit-field to save memory
@@ -75,9 +73,9 @@ struct MolAtom {
                                 ///< for instance, is this CG atom in an 
                                 ///< amino acid of some sort?
 
+  /// initialize the atom; the bond list storage is managed by the
+  /// molecule, and is left in place so bonds can be added again
   void init(int n, int theresid, char *insertion) { 
-    int i;
-
     uniq_resid = 0; // don't know yet, found in BaseMolecule
     bonds = 0;
     resid = theresid;
@@ -85,27 +83,10 @@ struct MolAtom {
     nameindex = typeindex = resnameindex = segnameindex = altlocindex = (-1);
     atomicnumber = (-1);
 
-    for (i=0; i<MAXATOMBONDS; i++) {
-      bondTo[i] = -1;
-    }
     atomType = ATOMNORMAL;
     residueType = RESNOTHING;
   }
   
-  /// add a bond into the atom.  Note that each bond will be stored twice, so
-  /// make sure when using bonds to define whether the 'official' bond is from
-  /// low # atom -> high #, or vice versa
-  int add_bond(int a, int type) {
-    if(bonds >= MAXATOMBONDS) // fail
-      return -1;
-
-    bondTo[(int) bonds] = a;
-    if (type == ATOMPROTEINBACK || type == ATOMNUCLEICBACK)
-      atomType = type;
-    bonds++;
-    return 0;
-  }
-
   /// return TRUE if this atom is bonded to the specified atom.  Returns FALSE
   /// otherwise.
   int bonded(int a) {
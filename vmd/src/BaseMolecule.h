@@ -95,7 +95,8 @@ public:
 
 #ifdef VMDWITHCARBS
   ResizeArray<SmallRing *> smallringList; ///< list of small rings
-                      ///< each ring is a single orientated chain
+                      ///< each ring is a single orientated chain,
+                      ///< owned by ringCache
   SmallRingLinkages smallringLinkages; ///< paths joining small rings
   int currentMaxRingSize;             ///< limit on size of small rings
   int currentMaxPathLength;           ///< limit on length of paths joining rings
@@ -188,13 +189,22 @@ public:
     max = radii_max;  
   }
 
-  /// number of electron pairs, also fractional
-  float *bondorders() { return extraflt.data("bondorders"); }
+  /// number of electron pairs, also fractional, for the bonds of an atom;
+  /// NULL if all bond orders are 1.
+  float *bondorders(int atom) {
+    if (bondOrderList == NULL || atomList[atom].bondTo == NULL)
+      return NULL;
+    return bondOrderList + (atomList[atom].bondTo - bondList);
+  }
   void setbondorder(int atom, int bond, float order);
   float getbondorder(int atom, int bond);
 
-  /// per atom/bond bond type list.
-  int *bondtypes() { return extraint.data("bondtypes"); }
+  /// bond types for the bonds of an atom; NULL if no types have been set.
+  int *bondtypes(int atom) {
+    if (bondTypeList == NULL || atomList[atom].bondTo == NULL)
+      return NULL;
+    return bondTypeList + (atomList[atom].bondTo - bondList);
+  }
 
   /// set new bond type
   void setbondtype(int atom, int bond, int type);
@@ -211,11 +221,23 @@ public:
   /// return the number of unique bonds in the molecule 
   int count_bonds(void);
 
+  /// pack the bond lists of all atoms into one contiguous array, releasing
+  /// the slack reserved while bonds were being added
+  void compact_bonds(void);
+
 #ifdef VMDWITHCARBS
   /// locate small rings and paths between them.
   void find_small_rings_and_links(int maxpathlength, int maxringsize);
+
+  /// drop the small rings and linkages, which are found again when next
+  /// asked for
+  void clear_small_rings(void);
 #endif
 
+  /// forget structure derived from the bonds, such as the small rings;
+  /// called whenever bonds are added or removed
+  void bonds_changed(void);
+
 private:
   const int ID;          ///< unique mol. ID number
 
@@ -224,13 +246,54 @@ private:
   //
   int cur_atom;          ///< index of next atom added
   MolAtom *atomList;     ///< atom data
-  int lastbonderratomid; ///< last atom id that generated a bonding error msg
-  int bonderrorcount;    ///< number of bonds-exceeded errors we've printed
+
+  //
+  // bond storage: the bond lists of all atoms are runs in one array, with
+  // bond orders and types in parallel arrays allocated only when needed.
+  // Runs are given room to grow while bonds are added, and packed into
+  // compressed sparse row form by compact_bonds().
+  //
+  int *bondList;         ///< bonded atom indices for all atoms
+  float *bondOrderList;  ///< bond orders parallel to bondList, or NULL
+  int *bondTypeList;     ///< bond types parallel to bondList, or NULL
+  int *bondCapacity;     ///< number of slots reserved for each atom's run
+  long bondListUsed;     ///< slots handed out, including abandoned runs
+  long bondListSize;     ///< slots allocated
+
+  //
+  // atom to term reverse indexes for the angles, dihedrals and impropers,
+  // in compressed sparse row form: the terms including atom i are
+  // terms[offsets[i]] through terms[offsets[i+1]-1].  They are built when
+  // first asked for and dropped when their term list changes.
+  //
+  typedef struct {
+    int *offsets;        ///< start of each atom's terms, nAtoms+1 entries
+    int *terms;          ///< term indices
+    int numterms;        ///< number of terms indexed, -1 if not built
+  } TermIndex;
+  TermIndex angleIndex, dihedralIndex, improperIndex;
+
+  /// drop a term index
+  static void clear_term_index(TermIndex &idx);
+
+  /// look up the terms of an atom, building the index first if needed
+  int atom_terms(TermIndex &idx, const ResizeArray<int> &list, int size,
+                 int atom, const int **terms);
+
+  /// reallocate the bond arrays and point the atoms' runs at the new array
+  void resize_bond_storage(long newsize);
+
+  /// move the run of an atom to where it has room for more bonds
+  void grow_bond_list(int atom);
  
   //
   // routines to determine components of molecular structure
   //
  
+  /// TRUE if every bond is listed for both of its atoms.  The threaded
+  /// connectivity searches depend on this.
+  int bonds_symmetric(void);
+
   /// Stage 1 of structure building.
   /// (a) find_backbone: assign atomType to atoms based on their
   /// backbone type.  This is the only place where these types get assigned.
@@ -259,18 +322,23 @@ private:
   /// (b) Assign residueType to each atom by checking for 4 atoms of a given
   ///     atomType in the sets of bonded atoms.  
   int find_residues(void);
+
+  /// Threaded version of find_residues(); needs symmetric bond lists.
+  int find_residues_threaded(void);
   
   /// Find the waters, based on resname, and return number.
   // This should take place after find_residues to keep
   // from mistaking a protein resname as a water resname, maybe
   void find_connected_waters(int i, char *tmp);
   int find_connected_waters2(void);
+  int find_connected_waters_threaded(void);
 
   /// Stage 2b of structure building.  This is essentially a continuation
   /// of Stage 2.  For atoms that do not yet have a residue type, their resname
   /// is matched against a list of water residue names.  residueType is 
-  /// assigned if there is match.
-  int find_waters(void);
+  /// assigned if there is match.  The connected waters are counted with
+  /// the threaded search if threaded is set.
+  int find_waters(int threaded);
 
   /// Stage 3 of structure building: 
   ///   (a) Create new residues.  The residue type is determined by the first
@@ -285,13 +353,18 @@ private:
   /// find the connected residues and put the info in fragList
   int find_connected_fragments();
 
+  /// Threaded version of find_connected_fragments(); needs symmetric
+  /// bond lists.
+  int find_connected_fragments_threaded(void);
+
   /// Stage 4 of structure building.
   ///    (a) Create new fragments, and assign residues to them.
   ///    (b) Assign fragment to each atom
   ///    (c) Sort fragments into protein framgents and nucleic fragments,
   ///        far more complex than one might guess, see the code for details.
   ///        This creates pfragList and nfragList for the molecule.
-  int find_fragments(void);
+  ///    The fragments are found with the threaded search if threaded is set.
+  int find_fragments(int threaded);
 
   void find_subfragments_cyclic(ResizeArray<Fragment *> *subfragList, int restype);  
   void find_cyclic_subfragments(ResizeArray<Fragment *> *subfragList, ResizeArray<int> *subfragCyclic);
@@ -315,14 +388,15 @@ private:
 #endif
 
 #ifdef VMDWITHCARBS
+   ResizeArray<SmallRing *> ringCache; ///< rings of up to ringCacheSize atoms
+   int ringCacheSize;                  ///< ring size searched, -1 if none
+
    /// find small rings
    int find_small_rings(int maxringsize);
    int find_back_edges(ResizeArray<int> &back_edge_src, ResizeArray<int> &back_edge_dest);
    int find_connected_subgraph_back_edges(int atomid, ResizeArray<int> &back_edge_src, ResizeArray<int> &back_edge_dest,
                                           int *intree_parents);
    int find_small_rings_from_back_edges(int maxringsize, ResizeArray<int> &back_edge_src, ResizeArray<int> &back_edge_dest);
-   int find_small_rings_from_partial(SmallRing *ring, int maxringsize, inthash_t *used_edges, inthash_t *used_atoms);
-   int get_edge_key(int edge_src, int edge_dest);
    
    // orientate small rings
    void orientate_small_rings(int maxringsize);
@@ -330,7 +404,7 @@ private:
    
    // find links between small rings
    int find_orientated_small_ring_linkages(int maxpathlength,int maxringsize);
-   int find_linkages_for_ring_from_partial(LinkagePath &lp, int maxpathlength, inthash_t *atom_to_ring, inthash_t *multi_ring_atoms, inthash_t *used_atoms);
+   int find_linkages_for_ring_from_partial(LinkagePath &lp, int maxpathlength, const int *atom_to_ring, const char *multi_ring_atoms, char *used_atoms);
 #endif
 
 
@@ -373,8 +447,21 @@ public:
   /// add a bond after checking for duplicates
   int add_bond_dupcheck(int, int, float, int);
 
+  /// add the bonds between npairs pairs of atoms given as consecutive
+  /// indices, with default order and type, optionally skipping duplicates
+  void add_bonds(const int *pairs, long npairs, int dupcheck);
+
+  /// remove the bond between a and b; return -1 if there is no such bond.
+  int del_bond(int a, int b);
+
+  /// append b to the bond list of atom a only, as done when the bond lists
+  /// of individual atoms are set; return the index of the new entry.
+  int add_bondto(int a, int b);
+
   /// clear list of angles and types.
-  void clear_angles(void) { angles.clear(); angleTypes.clear(); }
+  void clear_angles(void) {
+    angles.clear(); angleTypes.clear(); clear_term_index(angleIndex);
+  }
 
   /// count angle list entries.
   int num_angles() { return angles.num() / 3; }
@@ -390,7 +477,9 @@ public:
   int get_angletype(int a);
 
   /// clear list of dihedrals and types.
-  void clear_dihedrals(void) { dihedrals.clear(); dihedralTypes.clear(); }
+  void clear_dihedrals(void) {
+    dihedrals.clear(); dihedralTypes.clear(); clear_term_index(dihedralIndex);
+  }
 
   /// count dihedral list entries.
   int num_dihedrals() { return dihedrals.num() / 4; }
@@ -406,7 +495,9 @@ public:
   int get_dihedraltype(int d);
 
   /// clear list of impropers and types.
-  void clear_impropers(void) { impropers.clear(); improperTypes.clear(); }
+  void clear_impropers(void) {
+    impropers.clear(); improperTypes.clear(); clear_term_index(improperIndex);
+  }
 
   /// count improper list entries.
   int num_impropers() { return impropers.num() / 4; }
@@ -420,6 +511,20 @@ public:
   /// query improper type for number;
   int get_impropertype(int i);
 
+  /// Find the angles, dihedrals or impropers that include an atom: set
+  /// terms to the list of their indices and return how many there are.
+  /// The lists of all atoms are indexed when first asked for, so looking
+  /// up every atom in turn takes time linear in the number of terms.
+  int atom_angles(int atom, const int **terms) {
+    return atom_terms(angleIndex, angles, 3, atom, terms);
+  }
+  int atom_dihedrals(int atom, const int **terms) {
+    return atom_terms(dihedralIndex, dihedrals, 4, atom, terms);
+  }
+  int atom_impropers(int atom, const int **terms) {
+    return atom_terms(improperIndex, impropers, 4, atom, terms);
+  }
+
   /// clear list of improper definitions
   void clear_cterms() {cterms.clear();}
 
@@ -0,0 +1,70 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *      $RCSfile: DSSP.h,v $
+ *      $Author$        $Locker$             $State$
+ *      $Revision$       $Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *  Secondary structure assignment computed within VMD, following the
+ *  DSSP method of Kabsch and Sander (Biopolymers 22, 2577-2637, 1983).
+ *  The protein backbone is found once from the structure, after which
+ *  any number of frames can be assigned, concurrently if desired,
+ *  without writing files or running an external program.
+ ***************************************************************************/
+
+#ifndef DSSP_H__
+#define DSSP_H__
+
+#include "ResizeArray.h"
+
+class BaseMolecule;
+class DrawMolecule;
+
+/// Backbone atoms of the protein residues of a molecule, used to compute
+/// their secondary structure from a set of coordinates
+class DSSPBackbone {
+private:
+  ResizeArray<int> resids;      ///< uniq_resid of each backbone residue
+  ResizeArray<int> atoms;       ///< N, CA, C, O atom indices per residue
+  ResizeArray<int> fragments;   ///< fragment of each residue
+  ResizeArray<char> donors;     ///< residue N has an H (i.e. not proline)
+
+public:
+  DSSPBackbone(BaseMolecule *mol);
+
+  /// number of protein residues with a complete backbone
+  int num() const { return resids.num(); }
+
+  /// uniq_resid of the kth backbone residue
+  int resid(int k) const { return resids[k]; }
+
+  /// Assign the secondary structure of each backbone residue, as the
+  /// SS_ codes from Residue.h, from the coordinates in pos.  Only reads
+  /// the backbone, so it can be called from several threads at once.
+  /// The H-bond search is split over up to numthreads threads.
+  void assign(const float *pos, signed char *ss, int numthreads) const;
+};
+
+/// Assign the secondary structure of the current frame.  Returns 0 on
+/// success, like ss_from_stride().
+extern int ss_from_dssp(DrawMolecule *);
+
+/// Compute the secondary structure of frames first through last, which
+/// must be valid, into ss, which holds one SS_ code per residue of the
+/// molecule for each frame.  Residues which aren't protein are coil.
+/// Frames are computed in parallel.  The residues of the molecule are
+/// not changed.  Returns 0 on success.
+extern int ss_frames_dssp(DrawMolecule *, int first, int last,
+                          signed char *ss);
+
+#endif
@@ -36,6 +36,10 @@
 #include "VolumeTexture.h"
 
 class DrawMolecule;         ///< forward declaration
+class Orbital;
+class OrbitalGridCache;
+class GridSES;
+class Timestep;
 
 #ifdef VMDSURF
 #include "Surf.h"
@@ -134,6 +138,8 @@ private:
   MSMSInterface msms;          ///< MSMS interface class object
 #endif
 
+  GridSES *gridses;            ///< Internal MSMS and Surf surface engine
+
   int waveftype;               ///< Wavefunction type
   int wavefspin;               ///< Wavefunction spin
   int wavefexcitation;         ///< Wavefunction excitation
@@ -141,6 +147,8 @@ private:
   float orbgridspacing;        ///< Orbital grid spacing
   int orbgridisdensity;        ///< Grid contains density rather than amplitude
   VolumetricData *orbvol;      ///< Orbital grid
+  OrbitalGridCache *orbcache;  ///< Grids of recently drawn and upcoming frames
+  int orbframe;                ///< Frame the orbital grid was computed for
 
   // cached volume texture information to avoid unnecessary updates
   int voltexVolid;
@@ -239,6 +247,7 @@ private:
   void draw_msms(float *pos, int draw_wireframe, int allatoms, float radius, float density); ///< MSMS surface from Scripps
   void draw_quicksurf(float *pos, int quality, float radius, float isovalue, float spacing); ///< Fast surface representation
   void draw_surface(float *pos, int draw_wireframe, float radius); ///< Surf surface from UNC
+  void draw_gridses(float *pos, int draw_wireframe, int allatoms, float radius, float spacing); ///< Grid-based SES for MSMS and Surf reps
   void draw_hbonds(float *, float maxangle, int thickness, float cutoff); ///< Hydrogen bonds
   void draw_dynamic_bonds(float *, float brad, int bres, float cutoff); ///< on-the-fly bond animation
 
@@ -252,6 +261,7 @@ private:
   void draw_volume_field_lines(int volid, float seedval, float minlen, float maxlen, float thickness); ///< Volume gradient field lines
 
   void draw_orbital(int, int, int, int, int, float, int, int, float, int, int); ///< QM orbital isosurface
+  Orbital *make_orbital(const Timestep *, int, int, int, int, float *); ///< Orbital for a timestep, or NULL
 
   //@{
   // helper functions for volume rendering
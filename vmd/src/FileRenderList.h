@@ -94,6 +94,10 @@ public:
 
   /// Set the output format for the given renderer.  Return success.
   int set_format(const char *method, const char *format);
+
+  /// Wait for the given renderer to finish any background output.
+  /// Return success.
+  int wait_pending(const char *method);
 };
   
 #endif
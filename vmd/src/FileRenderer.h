@@ -38,6 +38,10 @@
 #define FILERENDERER_NOGEOM       16
 #define FILERENDERER_NOTEXT       32
 
+/// size of the stdio buffer attached to scene files, large scenes are 
+/// written in big blocks rather than many small write() calls
+#define FILERENDERER_OUTBUFSZ  (4 * 1024 * 1024)
+
 /// This is the base class for all the renderers that go to a
 /// file and are on the render list.  There are five operations
 /// available to the outside world
@@ -50,6 +54,7 @@ protected:
 
   char *execCmd;     ///< current version of the post-render command
   FILE *outfile;     ///< the current file
+  char *outbuf;      ///< stdio buffer used for the current file
   int isOpened;      ///< is the file opened correctly
   char *my_filename; ///< the current filename
   int has_aa;        ///< supports antialiasing; off by default
@@ -206,6 +211,11 @@ public:
   virtual int prepare3D(int); 
   virtual void render(const VMDDisplayList *); // render the display list
 
+  /// Wait for any output that is still being produced in the background
+  /// to be completely written.  Renderers that finish all of their work
+  /// within update() don't need to override this.
+  virtual void wait_pending(void) {}
+
 protected:
   /// write any trailer info.  This is called by update
   virtual void write_trailer(void) {};
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: GridSES.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *   Grid-based solvent excluded surface, computed within VMD rather than
+ *   by the external MSMS or SURF programs.  A map holding the distance
+ *   from each point to the nearest possible probe position, less the probe
+ *   radius, is built on a regular grid and its zero isosurface is
+ *   extracted with IsoSurface.  The map is kept between calls, and when
+ *   only some of the atoms have moved only the part of the map they
+ *   affect is recomputed.
+ ***************************************************************************/
+#ifndef GRIDSES_H
+#define GRIDSES_H
+
+#include "ResizeArray.h"
+#include "Isosurface.h"
+
+class VolumetricData;
+
+/// Solvent excluded surface of a set of spheres, computed on a grid
+class GridSES {
+private:
+  VolumetricData *vol;       ///< probe distance map, kept between calls
+  float origin[3];           ///< origin of the map
+  int numvoxels[3];          ///< map dimensions
+  ResizeArray<float> spheres;///< spheres the map was computed for
+  float proberad;            ///< probe radius the map was computed for
+  float gridspacing;         ///< grid spacing the map was computed for
+  float reqspacing;          ///< grid spacing requested for the map
+  float maxrad;              ///< largest sphere radius
+
+  /// compute the map for voxels lo through hi-1 along each axis
+  void compute_region(float *map, const int *lo, const int *hi);
+
+  /// decide whether the map can be updated in place for the new spheres,
+  /// and if so return the box of voxels that have to be recomputed
+  int update_region(int n, const float *xyzr, int *lo, int *hi) const;
+
+  /// find the sphere nearest to each vertex of the mesh
+  void find_vertex_spheres(void);
+
+public:
+  IsoSurface s;              ///< triangle mesh of the surface
+  ResizeArray<int> sphereids;///< nearest sphere for each mesh vertex
+
+  GridSES(void);
+  ~GridSES(void);
+
+  /// Compute the surface of n spheres, given as x, y, z, radius, for the
+  /// probe radius and grid spacing.  Returns 1 on success, 0 on failure.
+  int compute(int n, const float *xyzr, float probe_radius, float spacing);
+
+  void clear(void);          ///< free the map and the mesh
+};
+
+#endif
+
@@ -43,7 +43,7 @@ void vmd_writeppm(FILE *dfile, unsigned char * img, int xs, int ys);
 void vmd_writetga(FILE *dfile, unsigned char * img, int xs, int ys);
 
 #if defined(VMDPNG)
-/// Write 24-bit uncompressed PNG file
+/// Write 24-bit PNG file, compressed with multiple threads (requires zlib)
 void vmd_writepng(FILE *dfile, unsigned char * img, int xs, int ys);
 #endif
 
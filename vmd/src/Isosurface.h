@@ -44,6 +44,7 @@ class IsoSurface {
    const VolumetricData * vol;    ///< volume data pointer
    float xax[3], yax[3], zax[3];  ///< per-voxel/cell axes
    float xad[3], yad[3], zad[3];  ///< volume basis direction vectors
+   unsigned char *activebricks;   ///< bricks that may cross the isovalue
 
  public:
    IsoSurface(); ///< constructor
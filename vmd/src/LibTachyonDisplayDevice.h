@@ -26,6 +26,15 @@
 #include <stdio.h>
 #include "FileRenderer.h"
 #include "tachyon.h"       // main Tachyon library header
+#include "WKFThreads.h"
+
+/// A completed scene that is being ray traced by a background thread
+typedef struct {
+  SceneHandle scene;          ///< scene being rendered, deleted when done
+  rt_timerhandle buildtime;   ///< scene construction timer
+  rt_timerhandle rendertime;  ///< ray tracing timer
+  wkf_thread_t thread;        ///< thread rendering the scene
+} LibTachyonRenderJob;
 
 /// FileRenderer subclass renders via compiled-in Tachyon ray tracing engine
 class LibTachyonDisplayDevice : public FileRenderer {
@@ -41,6 +50,17 @@ private:
   float zplaneeq[4];
   rt_timerhandle buildtime;   ///< timer handle
   rt_timerhandle rendertime;  ///< timer handle
+  int usedvoltex;             ///< scene defined global volume textures
+
+  /// Frame pipelining: when enabled, completed scenes are ray traced and
+  /// written by background threads so that VMD can advance to the next
+  /// trajectory frame and build its scene while the previous ones render.
+  /// The number of frames in flight is bounded to limit memory use.
+  int maxinflight;            ///< max scenes rendering in the background
+  int numinflight;            ///< number of scenes currently in flight
+  int firstinflight;          ///< ring buffer index of oldest scene
+  LibTachyonRenderJob *jobs;  ///< ring buffer of in-flight scenes
+  void finish_oldest(void);   ///< wait for oldest in-flight scene
 
   void reset_vars(void);      ///< reset internal state betwen renders
   void * tex_cindexmaterial(int, int); ///< calc texture
@@ -88,6 +108,7 @@ public:
   virtual ~LibTachyonDisplayDevice(void);  // destructor
   virtual int open_file(const char *filename);
   virtual void close_file(void);
+  virtual void wait_pending(void);
   void write_header(void); 
   void write_trailer(void);
 }; 
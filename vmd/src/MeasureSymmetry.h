@@ -37,6 +37,8 @@
 
 #include "ResizeArray.h"
 
+class SymmetryIndex;
+
 // Flags for trans_overlap() specifying wether atoms that underwent
 // an identical transformation should be skipped in the evaluation.
 #define SKIP_IDENTICAL   1
@@ -65,6 +67,21 @@ typedef struct axis {
   int type;
 } Axis;
 
+// Candidate symmetry element with the transformation used to score it
+typedef struct elementcandidate {
+  float v[3];             // plane normal or axis direction
+  int order;              // order of axes and rotary reflections
+  float trans[16];        // symmetry operation of the element, as the
+                          // elements of a Matrix4 (kept as plain floats
+                          // since ResizeArray copies with memcpy)
+  float sigma;            // width of the overlap function
+  int skipident;          // flag to skip atoms left in place by trans
+  int scored;             // 1 if overlap was computed, 0 if it must be,
+                          // -1 if it isn't needed
+  float overlap;
+  float overlappermatch;
+} ElementCandidate;
+
 // Summary of existing symmetry elements
 typedef struct elementsummary {
   char inv;     // inversion center (0/1)?
@@ -112,6 +129,7 @@ private:
   int *atomindex;            ///< original atom index;
   int *uniqueatoms;          ///< array of flags indicating unique atoms
   float *idealcoor;          ///< idealized coordinates
+  SymmetryIndex *coorindex;  ///< spatial index of coor, NULL if out of date
 
   char *elementsummarystring;    ///< string summarizing symmetry elements
   char *missingelementstring;    ///< string summarizing missing elements
@@ -148,6 +166,19 @@ private:
   bool symmetrictop;  ///< is it a symmetrical top?
 
 
+  /// Return the spatial index of the current coordinates, which also
+  /// holds the atoms sampled for scoring. It is built when first needed
+  /// after the coordinates changed.
+  SymmetryIndex *coor_index();
+
+  /// Drop the spatial index; must be called whenever coor is modified.
+  void coor_changed();
+
+  /// Return 1 if a mirror plane normal or axis along v is consistent
+  /// with the principal axes of inertia, 0 if it cannot be a symmetry
+  /// element.
+  int inertia_compatible(const float *v);
+
   /// Self consistent iteration of symmetry element search
   int iterate_element_search();
 
@@ -175,13 +206,37 @@ private:
   /// it to the list if an equivalent one does not yet exist.
   void check_add_plane(const float *normal, int weight=1);
 
+  /// Add a mirror plane with the given overlap score, averaging
+  /// it with an existing coplanar plane.
+  void add_plane(const float *normal, float overlap, int weight);
+
   /// Check if the given vector defines a C2 rotary axis and add
   /// it to the list if an equivalent one does not yet exist.
   void check_add_axis(const float *testaxis, int order);
 
-  /// Check if the given vector feines a rotary reflection axis and
-  /// add it to the list if if an equivalent one does not yet exist.
-  void check_add_rotary_reflection(const float *testaxis, int maxorder);
+  /// Like check_add_axis() but with a precomputed overlap score.
+  /// If scored is 0 the overlap is computed when it is needed.
+  void add_axis(const float *testaxis, int order, int scored, float overlap);
+
+  /// Append an axis of the given order to the list of candidates.
+  void append_axis_candidate(ResizeArray<ElementCandidate> &candidates,
+                             const float *testaxis, int order);
+
+  /// Score the axis candidates where needed and add them to the list
+  /// in order, as check_add_axis() does.
+  void add_axis_candidates(ResizeArray<ElementCandidate> &candidates);
+
+  /// Add a rotary reflection with the given overlap score.
+  void add_rotary_reflection(const float *testaxis, int order, float overlap);
+
+  /// Append the rotary reflections that need to be checked for the
+  /// given axis to the candidate list.
+  void rotary_reflection_candidates(const float *testaxis, int maxorder,
+                                    ResizeArray<ElementCandidate> &candidates);
+
+  /// Compute the overlap score of all candidates with scored==0.
+  /// Larger lists are split over several threads.
+  void score_candidates(ResizeArray<ElementCandidate> &candidates);
 
 
   /// Classify vertical, dihedral and horizontal planes
@@ -19,7 +19,8 @@
  * NameList template, which stores a list of unique names indexed in the order
  * they are added.  For each name, which acts as a key, there is an associated
  * integer value.  NameList string lookups are accelerated through the use of
- * an internal hash table.
+ * an internal hash table.  The strings themselves are interned in the
+ * global StringPool, so they are shared with every other NameList.
  *
  ***************************************************************************/
 #ifndef NAMELIST_TEMPLATE_H
@@ -27,54 +28,88 @@
 
 #include <string.h>
 #include "ResizeArray.h" 
-#include "utilities.h"   // needed for stringdup()
-#include "hash.h"        // needed for hash table functions
+#include "utilities.h"
+#include "StringPool.h"  // interned name strings
 
 #define NLISTSIZE 64
 
 /// Template class, stores a list of unique names indexed in the order
 /// they are added.  For each name, which acts as a key, there is an associated
 /// integer value.  NameList string lookups are accelerated through the use of
-/// an internal hash table.
+/// an internal open addressing hash table of name indices.
 template<class T>
 class NameList  {
 protected:
   int Num;                   ///< number of items in the list
-  ResizeArray<char *> names; ///< array of pointers to the strings; 
+  ResizeArray<const char *> names; ///< pooled strings for the items
+  ResizeArray<unsigned int> hashes; ///< hash values of the names
   ResizeArray<T> Data;       ///< integer data for the items
-  hash_t hash;               ///< hash table used to accelerate finds etc.
+  int *table;                ///< hash table of name indices, -1 if empty
+  int tablesize;             ///< number of hash table slots, a power of two
+
+  /// index of the name nm with hash value h, or -1 if not found
+  int find(const char *nm, unsigned int h) const {
+    int mask = tablesize - 1;
+    int i = h & mask;
+    int idx;
+    while ((idx = table[i]) >= 0) {
+      if (hashes[idx] == h && !strcmp(names[idx], nm))
+        return idx;
+      i = (i + 1) & mask;
+    }
+    return -1;
+  }
+
+  /// put name index idx in the first free slot of its probe sequence
+  void place(int idx) {
+    int mask = tablesize - 1;
+    int i = hashes[idx] & mask;
+    while (table[i] >= 0)
+      i = (i + 1) & mask;
+    table[i] = idx;
+  }
+
+  /// rebuild the hash table with size slots; if a name occurs more than
+  /// once, after set_name(), the first occurrence is found
+  void rebuild(int size) {
+    delete [] table;
+    tablesize = size;
+    table = new int[tablesize];
+    memset(table, 0xff, tablesize * sizeof(int));
+    for (int i=0; i < Num; i++) {
+      if (find(names[i], hashes[i]) < 0)
+        place(i);
+    }
+  }
  
 public:
   ////////////////////  constructor
   // starts with no names, which are then added via the 'add_name' routine.  
-  NameList(void) : names(NLISTSIZE), Data(NLISTSIZE) {
+  NameList(void) : names(NLISTSIZE), hashes(NLISTSIZE), Data(NLISTSIZE) {
     Num = 0;
-    hash_init(&hash, 127);
+    table = NULL;
+    rebuild(NLISTSIZE);
   }
 
   ////////////////////  destructor
   virtual ~NameList(void) {
-    for(int i=0; i < Num; i++) {
-      if(names[i])
-        delete [] names[i];
-    }
-    hash_destroy(&hash);
+    for(int i=0; i < Num; i++)
+      stringpool_release(names[i]);
+    delete [] table;
   }
 
   int num(void) const { return Num; }    // return number of items
 
   // clear list. equivalent to running destructor and constructor.
   void clear(void) {
-    for(int i=0; i < Num; i++) {
-      if(names[i])
-        delete [] names[i];
-    }
-    hash_destroy(&hash);
+    for(int i=0; i < Num; i++)
+      stringpool_release(names[i]);
     Data.clear();
     names.clear();
+    hashes.clear();
     // start over.
     Num = 0;
-    hash_init(&hash, 127);
+    rebuild(NLISTSIZE);
   }
 
   // add a new name to the list, with a given associated value.
@@ -98,17 +133,25 @@ public:
     while(s != tmpnm && *(--s) == ' ')  // remove spaces at end of string
       *s = '\0';
 
+    unsigned int h = stringpool_hash(tmpnm);
     int myindex;  
-    if ((myindex = hash_lookup(&hash, tmpnm)) != HASH_FAIL) {
+    if ((myindex = find(tmpnm, h)) >= 0) {
       return myindex; 
     } 
 
     // if here, string not found; append new one, and return index = Num - 1
-    names.append(stringdup(tmpnm));
+    names.append(stringpool_intern(tmpnm));
+    hashes.append(h);
+    Data.append(val);
 
-    myindex = hash_insert(&hash, names[Num], Num); 
+    // keep the hash table at most half full
+    if (2 * (Num + 1) > tablesize) {
+      Num++;
+      rebuild(2 * tablesize);
+      return Num - 1;
+    }
 
-    Data.append(val);
+    place(Num);
     return Num++;
   }
 
@@ -131,7 +174,7 @@ public:
     if (!nm)
       return -1;
 
-    return hash_lookup(&hash, nm);  // returns -1 (HASH_FAIL) on no entry
+    return find(nm, stringpool_hash(nm));  // returns -1 on no entry
   }
 
 
@@ -142,8 +185,8 @@ public:
     if (!nm)
       return Data[0];
  
-    int myindex = hash_lookup(&hash, nm);
-    if (myindex != HASH_FAIL)
+    int myindex = find(nm, stringpool_hash(nm));
+    if (myindex >= 0)
       return Data[myindex];
   
     return Data[0];
@@ -169,15 +212,16 @@ public:
 
   // change the name of an entry
   void set_name(int a, const char *nm) {
-    if (a < 0 || a >= Num) 
+    if (a < 0 || a >= Num || !nm) 
       return;
 
-    // delete the hash table entry...
-    hash_delete(&hash, names[a]);
-    delete [] names[a];
-    names[a] = stringdup(nm);
-    // and put the pointer in our ResizeArray into the hash table
-    hash_insert(&hash, names[a], a);
+    // intern first, nm may be the pooled string we are releasing
+    const char *old = names[a];
+    names[a] = stringpool_intern(nm);
+    stringpool_release(old);
+    hashes[a] = stringpool_hash(names[a]);
+    // renames are rare, so just rebuild the hash table
+    rebuild(tablesize);
   } 
 
 };
@@ -0,0 +1,83 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: OSMesaDisplayDevice.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *
+ * Subclass of OpenGLRenderer, this object renders the scene into an
+ * in-memory framebuffer using an OSMesa off-screen context, allowing
+ * "render snapshot" and movie generation on machines with no X server
+ * and no graphics hardware.
+ *
+ ***************************************************************************/
+#ifndef OSMESADISPLAYDEVICE_H
+#define OSMESADISPLAYDEVICE_H
+
+#include "OpenGLRenderer.h"
+#include <GL/osmesa.h>
+
+class VMDApp;
+
+/// OSMesa-specific context handle and off-screen color buffer
+typedef struct {
+  OSMesaContext ctx;         ///< OSMesa off-screen rendering context
+  unsigned char *framebuf;   ///< RGBA color buffer the context draws into
+  int width;                 ///< width of the color buffer
+  int height;                ///< height of the color buffer
+} osmesadata;
+
+
+/// Subclass of OpenGLRenderer, this object renders into an off-screen
+/// OSMesa framebuffer rather than an X window, for headless batch use.
+class OSMesaDisplayDevice : public OpenGLRenderer {
+public:
+  osmesadata osmsrv;
+
+protected:
+  // flag for whether a context was successfully created by open_window
+  int have_window;
+
+  // create the off-screen context and framebuffer
+  int open_window(char *, int *, int *, int, char **);
+
+  virtual void do_resize_window(int, int);
+  virtual void do_reposition_window(int, int) {}
+
+public:
+  // constructor - trivial variable initialization, no context created yet.
+  OSMesaDisplayDevice();
+
+  // real initialization; return TRUE if the context was successfully created
+  // or FALSE if it wasn't.  Pass argc/argv from main, and size and location
+  // for the framebuffer, if known.  size must NOT be NULL.
+  int init(int argc, char **argv, VMDApp *app, int *size, int *loc = NULL);
+
+  virtual ~OSMesaDisplayDevice(void);
+
+  // there is no window, hence no menus, mouse, or keyboard events
+  virtual int supports_gui() { return FALSE; }
+
+  //
+  // virtual routines for preparing to draw, drawing, and finishing drawing
+  //
+  virtual void update(int do_update = TRUE);	// finish up after drawing
+  virtual void reshape(void);			// refresh device after change
+
+  // virtual routine for capturing the screen to a packed RGB array
+  virtual unsigned char * readpixels(int &x, int &y);
+};
+
+#endif
+
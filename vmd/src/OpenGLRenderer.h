@@ -187,6 +187,22 @@ protected:
   int immersadeskflip;   ///< Immersadesk right-eye X-axis reflection mode
   int shearstereo;       ///< Use shear matrix stereo rather than eye rotation
 
+  //@{
+  /// Automatic level-of-detail for sphere arrays and cylinders, enabled by
+  /// setting VMDLODTRIANGLES to a per-frame triangle budget.  Tessellation
+  /// is chosen from each primitive's projected size, and sub-pixel spheres
+  /// are drawn as points.
+  int lodenabled;        ///< select tessellation from on-screen size
+  float lodtribudget;    ///< target number of triangles per frame
+  float lodpixeltol;     ///< target facet edge length in pixels
+  float lodbudgetscale;  ///< resolution scale to meet the triangle budget
+  double loddemand;      ///< triangles requested so far in this frame
+  GLfloat lodmv[16];     ///< modelview matrix for the current primitive
+  float lodmvscale;      ///< uniform scale factor of the modelview matrix
+  float lodpixelscale;   ///< pixels per eye unit at unit distance
+  int lodperspective;    ///< projection has a perspective divide
+  //@}
+
   //@{
   /// 2D texturing features
   int hastex2d;
@@ -218,6 +234,9 @@ protected:
   void set_sphere_res(int);
   void set_sphere_mode(int);
   void cylinder(float *, float *, int, float, float);  // slow cylinder version
+  void lod_begin(void);                  ///< fetch current xforms for LOD
+  float lod_pixel_radius(const float *pos, float rad); ///< projected radius
+  int lod_res(float pixrad, int maxres, int minres, int sphere); ///< pick res
   void require_volume_texture(unsigned long ID, 
     unsigned xsize, unsigned ysize, unsigned zsize, unsigned char *texmap);
   int build3Dmipmaps(int, int, int, unsigned char *tx);
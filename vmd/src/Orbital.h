@@ -174,7 +174,9 @@ public:
   // basis set normalization factors.
   void normalize_wavefunction(const float *wfn);
 
-  // Compute the volumetric data for the orbital
+  // Compute the volumetric data for the orbital.
+  // If mol is NULL, the grid is computed on the CPU, which is safe
+  // to do from a background thread.
   int calculate_mo(DrawMolecule *mol, int density);
 
   // Compute the volumetric data for given point in space
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: OrbitalGridCache.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *   Cache of recently computed molecular orbital grids, so that stepping
+ *   back and forth through a trajectory doesn't recompute the orbital
+ *   for frames that have already been shown, and a background thread that
+ *   computes the grid for the frame that will be drawn next.
+ ***************************************************************************/
+#ifndef ORBITALGRIDCACHE_H
+#define ORBITALGRIDCACHE_H
+
+#include "ResizeArray.h"
+#include "WKFThreads.h"
+
+class Orbital;
+class VolumetricData;
+
+/// Identifies an orbital grid: the timestep it was computed from, a hash
+/// of the atom coordinates (so edited coordinates aren't matched), and
+/// the orbital and grid parameters of the representation.
+typedef struct {
+  const void *ts;            ///< Timestep the grid was computed from
+  const void *qmts;          ///< QMTimestep holding the wavefunction
+  unsigned long poshash;     ///< hash of the atom coordinates
+  int density;               ///< grid contains density rather than amplitude
+  int wavefnctype;           ///< wavefunction type
+  int wavefncspin;           ///< wavefunction spin
+  int wavefncexcitation;     ///< wavefunction excitation
+  int orbid;                 ///< orbital ID
+  float gridspacing;         ///< grid spacing
+} OrbitalGridKey;
+
+/// LRU cache of orbital grids with one background prefetch job
+class OrbitalGridCache {
+private:
+  /// one cached grid
+  typedef struct {
+    OrbitalGridKey key;
+    float origin[3];
+    float xaxis[3], yaxis[3], zaxis[3];
+    int numvoxels[3];
+    float *data;
+    long lastuse;            ///< value of usecount when last looked up
+  } Entry;
+
+  ResizeArray<Entry> entries;
+  long usecount;             ///< incremented on each lookup, for LRU eviction
+  long maxbytes;             ///< memory limit for the cached grids
+  long usedbytes;            ///< memory used by the cached grids
+
+  /// state of the background job; "done" is guarded by the mutex, the
+  /// rest is only touched by the job thread while it runs
+  struct PrefetchJob {
+    OrbitalGridKey key;
+    Orbital *orbital;        ///< orbital to evaluate, owned by the job
+    float *pos;              ///< copy of the coordinates used by orbital
+    float gridspacing;
+    int density;
+    VolumetricData *vol;     ///< result, NULL on failure
+    int done;
+    wkf_mutex_t mtx;
+    wkf_thread_t thr;
+  } job;
+  int jobactive;             ///< a job thread has been started and not joined
+
+  static void * prefetch_thread(void *voidparms);
+  void finish_job(int wait);
+  void evict(long bytes);
+
+public:
+  OrbitalGridCache(void);
+  ~OrbitalGridCache(void);
+
+  /// Return a new copy of the grid matching key, or NULL if it isn't
+  /// cached.  If the background job is computing this grid, wait for it.
+  VolumetricData *lookup(const OrbitalGridKey &key);
+
+  /// Store a copy of vol under key, evicting the least recently used
+  /// grids to stay within the memory limit
+  void insert(const OrbitalGridKey &key, const VolumetricData *vol);
+
+  /// Is a grid for key cached or being computed?
+  int pending(const OrbitalGridKey &key);
+
+  /// Start computing the grid for key in the background.  The cache
+  /// takes ownership of orbital and of the coordinate array pos that it
+  /// was created with.  Does nothing (other than freeing the arguments)
+  /// if caching is disabled or a job is still running.
+  void prefetch(const OrbitalGridKey &key, Orbital *orbital, float *pos,
+                float gridspacing, int density);
+
+  /// Wait for the background job and free all cached grids
+  void clear(void);
+
+  /// Is caching enabled?  The limit in MB is taken from VMDORBGRIDCACHEMB,
+  /// and setting it to 0 disables the cache and the prefetching.
+  int enabled(void) const { return maxbytes > 0; }
+
+  /// Hash of n atom coordinates
+  static unsigned long position_hash(const float *pos, int n);
+
+  /// Build a VolumetricData from a computed orbital grid.  The grid
+  /// data is handed to the new object.
+  static VolumetricData *make_volume(Orbital *orbital, int orbid);
+};
+
+#endif
+
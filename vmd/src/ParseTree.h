@@ -23,6 +23,7 @@
 
 #include "SymbolTable.h"
 #include "AtomParser.h"
+#include "hash.h"
 
 /// Simplifies the use of three basic data types in an array situation.
 /// It does the conversion as needed and can be told to change size
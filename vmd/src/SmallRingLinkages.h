@@ -48,8 +48,12 @@ public:
   void remove_last(void) { path.remove_last(); }
 
   LinkagePath* copy(void) {
-    LinkagePath *pathcopy;
-    pathcopy = new LinkagePath(*path.copy(),start_ring,end_ring);
+    LinkagePath *pathcopy = new LinkagePath();
+    for (int i=0; i < path.num(); i++)
+      pathcopy->append(path[i]);
+    pathcopy->path.orientated = path.orientated;
+    pathcopy->start_ring = start_ring;
+    pathcopy->end_ring = end_ring;
     return pathcopy;
   }
 
@@ -99,11 +103,17 @@ public:
   }
 
   ~SmallRingLinkages(void) {
+    clear();
     inthash_destroy(edges_to_links);
     delete edges_to_links;
   }
 
   void clear(void) {
+    int i;
+    for (i=0; i < links.num(); i++)
+      delete links[i];
+    for (i=0; i < paths.num(); i++)
+      delete paths[i];
     links.clear();
     paths.clear();
     inthash_destroy(edges_to_links);
@@ -25,19 +25,38 @@
 #define SNAPSHOTDISPLAYDEVICE
 
 #include "FileRenderer.h"
+#include "WKFThreads.h"
+
+/// Image captured from the display that is waiting to be written to disk
+typedef struct {
+  FILE *outfile;             ///< opened output file, closed when written
+  unsigned char *img;        ///< image pixels, freed when written
+  int xs, ys;                ///< image size
+  void (*writeimage)(FILE *, unsigned char *, int, int); ///< format writer
+} SnapshotWriteJob;
 
 /// FileRenderer subclass to save VMD images in a supported image file format
 class SnapshotDisplayDevice : public FileRenderer {
 private:
   DisplayDevice *display;
 
+  /// When VMDSNAPSHOTASYNC is set, images are encoded and written by a
+  /// background thread while VMD goes on to draw the next frame.  Only one
+  /// image is in flight at a time, which bounds the memory in use.
+  int asyncwrite;            ///< write images in a background thread
+  int writepending;          ///< background write is in progress
+  wkf_thread_t writethread;  ///< thread writing the pending image
+  SnapshotWriteJob writejob; ///< image being written in the background
+
 public:
   /// set up the commands for grabbing images from the screen
   /// pass in display to grab image from
   SnapshotDisplayDevice(DisplayDevice *);
+  virtual ~SnapshotDisplayDevice(void);
   virtual int open_file(const char *filename);   ///< open output
   virtual void render(const VMDDisplayList*) {}  ///< ignore renders
   virtual void close_file(void); ///< capture and save the image to a file
+  virtual void wait_pending(void); ///< finish writing pending image
 };  
 #endif
 
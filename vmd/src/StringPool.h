@@ -0,0 +1,47 @@
+/***************************************************************************
+ *cr                                                                       
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the           
+ *cr                        University of Illinois                       
+ *cr                         All Rights Reserved                        
+ *cr                                                                   
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: StringPool.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *
+ * Process-wide pool of interned strings.  The name tables of all molecules
+ * take their strings from here, so loading many copies of a structure only
+ * stores each atom, type, residue, and segment name once, and equal names
+ * always have the same address.
+ *
+ ***************************************************************************/
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+/// FNV-1a hash of a string, used by the pool and by NameList
+inline unsigned int stringpool_hash(const char *s) {
+  unsigned int h = 2166136261U;
+  while (*s) {
+    h ^= (unsigned char) *s++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/// Return the pooled copy of s, adding it to the pool if needed.  Each
+/// call takes a reference that must be given back with stringpool_release().
+const char *stringpool_intern(const char *s);
+
+/// Drop a reference taken by stringpool_intern(); the string is freed when
+/// the last reference is gone.
+void stringpool_release(const char *s);
+
+#endif
+
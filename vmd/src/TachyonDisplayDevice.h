@@ -37,12 +37,22 @@ private:
   float yplaneeq[4];
   float zplaneeq[4];
 
+  /// Solid textures are emitted once as named TexDef blocks, and objects
+  /// that share the same color and material state reference them by name
+  /// rather than repeating the full texture body for every primitive.
+  int texcount;               ///< number of named textures emitted so far
+  int lasttexid;              ///< ID of most recently emitted texture, or -1
+  float lasttex[13];          ///< color/material state of lasttexid
+
   void reset_vars(void);      ///< reset internal state between renders
   void write_camera(void);    ///< write out camera specification
   void write_lights(void);    ///< write out the active lights
   void write_materials(void); ///< write out colors, textures, materials etc.
   void write_cindexmaterial(int, int);    ///< write colors, materials etc.
   void write_colormaterial(float *, int); ///< write colors, materials etc.
+  void write_texbody(const float *);      ///< write texture parameters
+  int define_colormaterial(const float *);///< emit shared texture definition
+  void write_texref(int, float *);        ///< reference shared texture
 
 protected:
   // assorted graphics functions
@@ -314,6 +314,10 @@ public:
   int filerender_render(const char *method, const char *filename,
                         const char *extcmd);
 
+  /// wait for background rendering to finish writing all output files;
+  /// return success
+  int filerender_wait(const char *method);
+
   /// set the command string to execute after producing the scene file
   /// Return the new value, or NULL if the method is invalid.   Specify option 
   /// as NULL to fetch the current value.
@@ -914,6 +918,13 @@ public:
   /// molecule based on the current set of coordinates.  Return true if the
   /// secondary structure was successfully recalculated, otherwise false.
   int molecule_ssrecalc(int molid);
+
+  /// Compute the secondary structure of frames first through last of the
+  /// given molecule, without changing the structure assigned to its
+  /// residues.  Returns a new array with one SS_ code from Residue.h per
+  /// residue for each frame, which the caller must delete [], and the
+  /// number of residues in numres, or NULL on failure.
+  signed char *molecule_ssframes(int molid, int first, int last, int *numres);
    
   /// Create a new wavefunction object based on existing wavefunction
   /// <waveid> with orbitals localized using the Pipek-Mezey algorithm.
@@ -18,4 +18,21 @@
 
 int vol_cpotential(long int natoms, float* atoms, float* grideners, long int numplane, long int numcol, long int numpt, float gridspacing); 
 
+/// Short-range coulombic potential map: only atoms within cutoff of a
+/// grid point contribute, with the MSM splitting 1/r - g(r) so that the
+/// potential goes smoothly to zero at the cutoff.  Atoms are binned by
+/// grid plane, and each thread accumulates the contributions of the atoms
+/// near its planes, so the cost is O(atoms * cutoff^3) rather than
+/// O(atoms * gridpoints).
+int vol_cpotential_cutoff(long int natoms, float* atoms, float* grideners, long int numplane, long int numcol, long int numpt, float gridspacing, float cutoff);
+
+/// coulombic potential methods, as chosen by vol_cpotential_select_method()
+enum { VOLCPOT_DIRECT=0, VOLCPOT_CUTOFF, VOLCPOT_MSM };
+
+/// Pick the cheapest method that meets the accuracy requested: direct
+/// summation while it is affordable, otherwise the cutoff kernel if a
+/// short-range potential is acceptable (allowcutoff), else MSM if it is
+/// available (havemsm).
+int vol_cpotential_select_method(long int natoms, long int gridpoints, int allowcutoff, int havemsm);
+
 #endif
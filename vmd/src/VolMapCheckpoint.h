@@ -0,0 +1,71 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: VolMapCheckpoint.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *
+ * Reader and writer for the chunked binary map format (.vmap) used for
+ * volmap and ILS checkpoints.  The voxels are stored as raw floats in
+ * slabs of z planes, each with its own checksum, so that the slabs can be
+ * written concurrently and a damaged file is detected when it is read.
+ * Several grids of the same size ("channels") can be stored in one file,
+ * together with the frame counters needed to resume a calculation.
+ *
+ * The files are also read by the molfile "vmap" plugin.
+ *
+ ***************************************************************************/
+
+#ifndef VOLMAPCHECKPOINT_H
+#define VOLMAPCHECKPOINT_H
+
+class VolumetricData;
+
+/// maximum number of grids stored in one file
+#define VOLMAP_CHUNKED_MAXCHANNELS 4
+
+/// Grid geometry, contents, and resume state of a chunked map file
+typedef struct {
+  char name[104];           ///< dataset name
+  double origin[3];         ///< same conventions as VolumetricData
+  double xaxis[3], yaxis[3], zaxis[3];
+  int xsize, ysize, zsize;
+  int nchannels;            ///< number of grids stored
+  char channelname[VOLMAP_CHUNKED_MAXCHANNELS][64];
+  int computed_frames;      ///< number of frames combined so far
+  int nextframe;            ///< first frame that still has to be computed
+  int combine;              ///< combination rule, checked on resume
+} volmap_chunked_header;
+
+/// Write the given channels to filename.  The file is first written under
+/// a temporary name and then renamed, so an existing checkpoint is only
+/// replaced by a complete one.  Returns 0 on success, -1 on error.
+int volmap_write_chunked(const char *filename,
+                         const volmap_chunked_header *header,
+                         const float * const *channels);
+
+/// Write a single map in the chunked format
+int volmap_write_chunked_map(const VolumetricData *vol, const char *filename);
+
+/// Read the header of a chunked map file.  Returns 0 on success, -1 if
+/// the file can't be read or isn't a chunked map.
+int volmap_read_chunked_header(const char *filename,
+                               volmap_chunked_header *header);
+
+/// Read all channels of a chunked map file into the preallocated arrays,
+/// verifying the checksum of every slab.  Returns 0 on success, -1 on
+/// error or if any slab is damaged.
+int volmap_read_chunked(const char *filename, float **channels);
+
+#endif
@@ -42,12 +42,24 @@ protected:
   int computed_frames;    // frame counter
   int checkpoint_freq;    // write checkpoint file every xxx steps
   char *checkpoint_name;  // checkpoint file name
+  int resume;             // continue from the checkpoint file if possible
   bool user_minmax;       // true = user specified a minmax box, false = compute default minmax
   float min_coord[3], max_coord[3]; // used to pass user defaults, avoid using for computations!
 
+  int maxthreads;         // max threads a single compute_coords() may use
+
 protected:
   virtual int compute_frame(int frame, float *voldata) = 0;
   int compute_init(float padding);
+
+  /// updates the selection for the given frame and calls compute_coords(),
+  /// for map types that implement the latter
+  int compute_frame_coords(int frame, float *voldata);
+
+  /// computes all frames several at a time using compute_coords()
+  int compute_all_frames_parallel(CombineType method, void *customptr,
+                                  float *voldata, int startframe,
+                                  int numframes, int numprocs);
   
   /// called before computing individual frames
   virtual int compute_init() {return compute_init(0.);}
@@ -64,20 +76,51 @@ protected:
   void combo_export(CombineType method, float *voldata, void *customptr);
   void combo_end(CombineType method, void *customptr);
 
+  /// Write the exported map and the combination buffers to the checkpoint
+  /// file in the chunked map format, recording nextframe for resuming
+  int write_checkpoint(CombineType method, float *voldata, void *customptr,
+                       int nextframe);
+
+  /// Restore the combination buffers from the checkpoint file if it
+  /// matches this calculation.  Returns the first frame still to be
+  /// computed, or 0 if there is no usable checkpoint.
+  int read_checkpoint(CombineType method, float *voldata, void *customptr,
+                      int numframes);
+
 
 public:
   VolumetricData *volmap;
   
   VolMapCreate(VMDApp *app, AtomSel *sel, float resolution);
   virtual ~VolMapCreate();
+
+  /// Thread-safe map kernel for map types that depend only on the selected
+  /// atom coordinates, which allows compute_all() to compute many frames at
+  /// once.  The selection flags and range for the frame are passed in since
+  /// the AtomSel itself can only be updated by one frame at a time.
+  /// Returns -1 if the map type doesn't provide one.
+  virtual int compute_coords(const float *coords, const int *on,
+                             int firstsel, int lastsel, float *voldata) {
+    return -1;
+  }
+  virtual int has_compute_coords() { return 0; }
+
+  /// Add a frame to the combination buffer, elementwise over [start, end)
+  void combo_addframe_range(CombineType method, float *voldata, 
+                            void *customptr, float *framedata,
+                            int start, int end);
   
   void set_minmax (float minx, float miny, float minz, float maxx, float maxy, float maxz);
 
   void set_checkpoint (int checkpointfreq, char *checkpointname);
+
+  /// continue from the checkpoint file written by an interrupted run
+  void set_resume (int doresume) { resume = doresume; }
   
   int compute_all(bool allframes, CombineType method, void *params);
 
-  /// For now this will call write_dx_file, but this is going to change to using
+  /// For now this will call write_dx_file (or write a chunked map if the
+  /// file name ends in .vmap), but this is going to change to using
   /// molfileplugin instead. In VolMapCreate*Energy this method is
   /// overridden by one that adds temperature and weight information to the 
   /// data set name string.
@@ -97,6 +140,10 @@ private:
   float atomradius;
 
 public:
+  int compute_coords(const float *coords, const int *on,
+                     int firstsel, int lastsel, float *voldata);
+  int has_compute_coords() { return 1; }
+
   VolMapCreateMask(VMDApp *app, AtomSel *sel, float res, float the_atomradius) : VolMapCreate(app, sel, res) {
     atomradius = the_atomradius;
   }
@@ -111,6 +158,15 @@ protected:
   float radius_scale; // mult. factor for atomic radii
   
 public:
+  int compute_coords(const float *coords, const int *on,
+                     int firstsel, int lastsel, float *voldata);
+  int has_compute_coords() { return 1; }
+
+  /// splat the selected atoms onto grid planes [zstart, zend) only
+  void splat_slab(const float *coords, const int *on, int firstsel,
+                  int lastsel, const float *radius, float *voldata,
+                  int zstart, int zend);
+
   VolMapCreateDensity(VMDApp *app, AtomSel *sel, float res, float *the_weight, float the_radscale) : VolMapCreate(app, sel, res) {
     weight = the_weight;
     // number of random points to use for each atom's gaussian distr.
@@ -126,6 +182,10 @@ protected:
   int compute_frame(int frame, float *voldata);
 
 public:
+  int compute_coords(const float *coords, const int *on,
+                     int firstsel, int lastsel, float *voldata);
+  int has_compute_coords() { return 1; }
+
   VolMapCreateInterp(VMDApp *app, AtomSel *sel, float res, float *the_weight) : VolMapCreate(app, sel, res) {
     weight = the_weight;
   }
@@ -139,6 +199,10 @@ protected:
   int compute_init();
   int compute_frame(int frame, float *voldata);  
 public:
+  int compute_coords(const float *coords, const int *on,
+                     int firstsel, int lastsel, float *voldata);
+  int has_compute_coords() { return 1; }
+
   VolMapCreateOccupancy(VMDApp *app, AtomSel *sel, float res, bool use_point_particles) : VolMapCreate(app, sel, res) {
     use_points = use_point_particles;
   }
@@ -151,19 +215,27 @@ protected:
   int compute_init();
   int compute_frame(int frame, float *voldata);  
 public:
+  int compute_coords(const float *coords, const int *on,
+                     int firstsel, int lastsel, float *voldata);
+  int has_compute_coords() { return 1; }
+
   VolMapCreateDistance(VMDApp *app, AtomSel *sel, float res, float the_max_dist) : VolMapCreate(app, sel, res) {
     max_dist = the_max_dist;
   }
 };
 
 
+/// Coulomb potential map, by direct summation over all atoms, or with the
+/// short-range cutoff kernel if a cutoff is given
 class VolMapCreateCoulombPotential : public VolMapCreate {
 protected:
+  float cutoff;  ///< 0 for direct summation
   int compute_init();
   int compute_frame(int frame, float *voldata);
   
 public:
-  VolMapCreateCoulombPotential(VMDApp *app, AtomSel *sel, float res) : VolMapCreate(app, sel, res) {
+  VolMapCreateCoulombPotential(VMDApp *app, AtomSel *sel, float res, float thecutoff=0.f) : VolMapCreate(app, sel, res) {
+    cutoff = thecutoff;
   }
 };
 
@@ -267,6 +339,10 @@ private:
   int first, last;        // trajectory frame range
   int computed_frames;    // # frames processed
 
+  int checkpoint_freq;    // write checkpoint file every xxx frames
+  char *checkpoint_name;  // checkpoint file name
+  int resume;             // continue from the checkpoint file if possible
+
   float max_energy;   // max energy considered in map, all higher energies
                       // will be clamped to this value.
   float min_occup;    // occupancies below this value will be treated
@@ -310,6 +386,12 @@ private:
   // ILS calculation for the given frame
   int compute_frame(int frame, float *voldata);
 
+  // Write the accumulated (subsampled) occupancy grid to the checkpoint
+  // file, and read it back when resuming.  read_checkpoint() returns the
+  // next frame to compute, or first if there is no usable checkpoint.
+  int write_checkpoint(const float *combo_voldata, int nextframe);
+  int read_checkpoint(float *combo_voldata);
+
   // Align current frame to the reference
   void align_frame(Molecule *mol, int frame, float *coords,
 		   Matrix4 &alignment);
@@ -363,9 +445,17 @@ public:
   int add_map_to_molecule();
 
   /// Include temperature and weight information to the data set
-  /// name string and write the map into a dx file.
+  /// name string and write the map into a dx file, or a chunked map
+  /// file if the name ends in .vmap.
   int write_map(const char *filename);
 
+  /// Write the accumulated occupancies to a chunked map file every
+  /// checkpointfreq frames, so an interrupted run can be resumed
+  void set_checkpoint(int checkpointfreq, const char *checkpointname);
+
+  /// continue from the checkpoint file written by an interrupted run
+  void set_resume(int doresume) { resume = doresume; }
+
   // Set probe coordinates,charges and VDW parameters
   void set_probe(int num_probe_atoms, int num_conf,
                  const float *probe_coords,
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *cr
+ *cr            (C) Copyright 1995-2011 The Board of Trustees of the
+ *cr                        University of Illinois
+ *cr                         All Rights Reserved
+ *cr
+ ***************************************************************************/
+
+/***************************************************************************
+ * RCS INFORMATION:
+ *
+ *	$RCSfile: VolMapOps.h,v $
+ *	$Author$	$Locker$		$State$
+ *	$Revision$	$Date$
+ *
+ ***************************************************************************
+ * DESCRIPTION:
+ *
+ * Multithreaded in-process versions of the volutil map operations
+ * (smoothing, resampling, arithmetic, and correlation) that work
+ * directly on VolumetricData objects rather than on DX files, and the
+ * per-frame map-to-model correlation used by "mdff ccc".
+ *
+ ***************************************************************************/
+
+#ifndef VOLMAPOPS_H
+#define VOLMAPOPS_H
+
+class VolumetricData;
+class VMDApp;
+class AtomSel;
+
+/// binary operations supported by volmap_binary_op()
+enum {VOLMAPOP_ADD=0, VOLMAPOP_SUBTRACT, VOLMAPOP_MULTIPLY, VOLMAPOP_AVERAGE};
+
+/// Gaussian blur computed as three separable 1-D passes.  As in volutil,
+/// sigma is the 3-D width, which is divided by sqrt(3) along each axis.
+/// If pad is set, the map is first padded with zeros by the kernel width
+/// on each side.  Returns a new map, or NULL on error.
+VolumetricData *volmap_smooth(const VolumetricData *src, double sigma, int pad);
+
+/// Average 2x2x2 blocks of voxels into a map of half the resolution
+VolumetricData *volmap_downsample(const VolumetricData *src);
+
+/// Double the resolution of the map with cubic interpolation
+VolumetricData *volmap_supersample(const VolumetricData *src);
+
+/// Rescale the map so that values are in units of sigma above the mean
+VolumetricData *volmap_sigma_scale(const VolumetricData *src);
+
+/// Count the voxels falling in each of nbins equal bins spanning the data
+/// range; bins must hold nbins ints.  Returns the data range in min/max.
+int volmap_histogram(const VolumetricData *src, int nbins, int *bins,
+                     float *min, float *max);
+
+/// Combine two maps voxel by voxel with one of the VOLMAPOP_ operations.
+/// Maps on identical grids are combined directly; otherwise the result
+/// covers the intersection (or union) of the two orthogonal maps, sampled
+/// at the finer of the two spacings, with nearest-neighbor or trilinear
+/// lookups.  Returns a new map, or NULL if the maps can't be combined.
+VolumetricData *volmap_binary_op(const VolumetricData *volA,
+                                 const VolumetricData *volB, int op,
+                                 int useunion, int interp);
+
+/// Compute the correlation coefficient of two maps over their intersection.
+/// If usethreshold is set, voxels of volB that are no more than threshold
+/// sigmas above its mean are excluded, as with "volutil -threshold".
+/// Returns 0 on success, -1 if the maps don't overlap.
+int volmap_correlate(const VolumetricData *volA, const VolumetricData *volB,
+                     int interp, int usethreshold, double threshold,
+                     double *cc);
+
+/// Correlate the density simulated from a selection, as by "mdff sim",
+/// with a target map for frames first to last in steps of stride.  The
+/// density is simulated into a reusable buffer covering only the target
+/// region, and the global correlation (and, if usethreshold is set, the
+/// local correlation over voxels whose simulated density is more than
+/// threshold sigmas above its mean) is computed for each frame in a single
+/// pass.  weight holds one value per selected atom; globalcc and localcc
+/// must hold one value per frame, and localcc may be NULL.
+/// Returns 0 on success, -1 on error.
+int volmap_ccc_frames(VMDApp *app, AtomSel *sel, float *weight,
+                      const VolumetricData *target, double resolution,
+                      double spacing, int first, int last, int stride,
+                      int interp, int usethreshold, double threshold,
+                      double *globalcc, double *localcc);
+
+#endif
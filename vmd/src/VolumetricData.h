@@ -23,6 +23,16 @@
 #ifndef VOLUMETRICDATA_H
 #define VOLUMETRICDATA_H
 
+//
+// Blocked storage parameters.  Volumes are tiled by cubic bricks of
+// VOLBRICKDIM^3 voxels; per-brick value ranges are kept for every map,
+// and sparse maps store only the bricks that aren't uniform.
+//
+#define VOLBRICKSHIFT 3                             ///< log2 of brick edge
+#define VOLBRICKDIM   (1 << VOLBRICKSHIFT)          ///< voxels per brick edge
+#define VOLBRICKMASK  (VOLBRICKDIM - 1)             ///< in-brick index mask
+#define VOLBRICKSIZE  (VOLBRICKDIM*VOLBRICKDIM*VOLBRICKDIM) ///< voxels/brick
+
 /// Volumetric data class for potential maps, electron density maps, etc
 class VolumetricData {
 public:
@@ -32,10 +42,22 @@ public:
   double yaxis[3];         ///< direction and length for Y axis (non-unit)
   double zaxis[3];         ///< direction and length for Z axis (non-unit)
   int xsize, ysize, zsize; ///< number of samples along each axis
-  float *data;             ///< raw data, total of xsize*ysize*zsize voxels
+  float *data;             ///< raw data, total of xsize*ysize*zsize voxels,
+                           ///< NULL when the map is held in sparse bricks
   float *gradient;         ///< negated normalized volume gradient map
   float datamin, datamax;  ///< min and max data values 
 
+  int xbricks, ybricks, zbricks; ///< number of bricks along each axis
+  float *brickmin;         ///< per-brick minimum data values
+  float *brickmax;         ///< per-brick maximum data values
+  float **bricks;          ///< sparse brick storage, NULL for dense maps;
+                           ///< NULL entries are uniform bricks whose value
+                           ///< is given by brickmin
+  mutable float **gradbricks; ///< per-brick gradients, computed on demand
+                              ///< when no full gradient map is resident
+  mutable unsigned short **hgradbricks; ///< half precision brick gradients
+  int halfgradients;       ///< store brick gradients in half precision
+
   /// constructor
   VolumetricData(const char *name, const float *origin, 
                  const float *xaxis, const float *yaxis, const float *zaxis,
@@ -47,6 +69,45 @@ public:
   /// return total number of gridpoints
   int gridsize() const { return xsize*ysize*zsize; }
 
+  /// return total number of bricks
+  int numbricks() const { return xbricks*ybricks*zbricks; }
+
+  /// (re)compute the per-brick value ranges after the dense data changes
+  void compute_brick_ranges(void);
+
+  /// Convert a dense map to sparse brick storage, eliding bricks whose
+  /// values vary by no more than tol.  The dense array and gradient are
+  /// freed if the bricked form needs at most maxfrac of the dense memory.
+  /// Returns 1 if the map was converted, 0 if it was left dense.
+  int compact_bricks(float tol = 0.0f, float maxfrac = 0.5f);
+
+  /// return TRUE if the map is held in sparse brick storage
+  int is_sparse() const { return (!data && bricks); }
+
+  /// return the number of bytes used for voxel and gradient storage
+  long memory_size() const;
+
+  /// Return a pointer to the dense voxel array.  Sparse maps are expanded
+  /// into a newly allocated array that the caller must delete [] if the
+  /// returned pointer differs from the data member.
+  float *access_raw_data() const;
+
+  /// Return a pointer to the voxels of row (y, z).  Dense maps return a
+  /// pointer into data, sparse maps fill and return the caller's buffer,
+  /// which must hold xsize floats.
+  const float *voxel_row(int y, int z, float *rowbuf) const;
+
+  /// Return the minimum and maximum values over all voxels a cell anchored
+  /// in brick (bx, by, bz) can touch, for cells extending step voxels.
+  /// Used to skip empty regions during isosurface extraction.
+  void brick_cell_range(int bx, int by, int bz, int step,
+                        float *rmin, float *rmax) const;
+
+  /// Return a newly allocated array of per-brick flags that are nonzero for
+  /// bricks that may contain cells crossing isovalue, given the cell step.
+  /// Returns NULL if no brick ranges are available.
+  unsigned char *active_bricks(float isovalue, int step) const;
+
   /// Sets data name to an internal copy of the provided string
   void set_name(const char* name);
 
@@ -67,7 +128,20 @@ public:
 
   /// return voxel at requested index, no safety checks
   inline float voxel_value(int x, int y, int z) const {
-    return data[z*xsize*ysize + y*xsize + x];
+    if (data)
+      return data[z*xsize*ysize + y*xsize + x];
+    return brick_voxel_value(x, y, z);
+  }
+
+  /// return voxel at requested index from sparse brick storage
+  inline float brick_voxel_value(int x, int y, int z) const {
+    int b = ((z >> VOLBRICKSHIFT)*ybricks + (y >> VOLBRICKSHIFT))*xbricks +
+            (x >> VOLBRICKSHIFT);
+    const float *brk = bricks[b];
+    if (!brk)
+      return brickmin[b];
+    return brk[(((z & VOLBRICKMASK) << VOLBRICKSHIFT) + (y & VOLBRICKMASK))
+               * VOLBRICKDIM + (x & VOLBRICKMASK)];
   }
 
   /// return voxel, after safely clamping index to valid range
@@ -81,17 +155,43 @@ public:
   float voxel_value_interpolate_from_coord(float xpos, float ypos, float zpos) const;
 
 
-  /// (re)compute the volume gradient
+  /// (re)compute the full volume gradient, threaded across z slabs
   void compute_volume_gradient(void);
 
+  /// compute the full gradient map for planes zstart up to zend
+  void compute_gradient_slab(float *grad, int zstart, int zend) const;
+
+  /// Discard any resident gradients; they are recomputed per-brick
+  /// as they are requested
+  void invalidate_gradient(void);
+
+  /// store per-brick gradients in half precision to save memory
+  void set_half_gradients(int onoff);
+
+  /// compute and store the gradient of brick b if it isn't resident yet
+  void gradient_brick(int b) const;
+
+  /// Compute the gradients of the bricks that cells anchored in the flagged
+  /// bricks can reach for the given cell step, or all bricks if the flags
+  /// are NULL.  Large requests are computed in parallel.
+  void compute_gradient_bricks(const unsigned char *needed, int step) const;
+
   /// return gradient at requested index, no safety checks
   void voxel_gradient_fast(int x, int y, int z, float *grad) const {
+    if (!gradient) {
+      brick_voxel_gradient(x, y, z, grad);
+      return;
+    }
     int index = (z*xsize*ysize + y*xsize + x) * 3;
     grad[0] = gradient[index    ];
     grad[1] = gradient[index + 1];
     grad[2] = gradient[index + 2];
   }
 
+  /// return gradient from the per-brick gradients, computing the 
+  /// gradient of the enclosing brick if needed
+  void brick_voxel_gradient(int x, int y, int z, float *grad) const;
+
   /// return gradient, after safely clamping index to valid range
   void voxel_gradient_safe(int x, int y, int z, float *grad) const;
 
@@ -102,6 +202,18 @@ public:
   void voxel_gradient_from_coord(const float *coord, float *gradient) const;
   void voxel_gradient_interpolate_from_coord(const float *coord, float *gradient) const;
 
+private:
+  /// compute the gradient of one brick
+  float *compute_brick_gradient(int b) const;
+
+  /// allocate the (empty) per-brick gradient pointer arrays
+  void alloc_gradient_bricks(void) const;
+
+  /// free sparse brick storage
+  void free_bricks(void);
+
+  /// free the per-brick gradients
+  void free_gradient_bricks(void);
 };
 
 
@@ -117,11 +229,17 @@ public:
   }
 
 /// fast but unsafe macro for querying volume gradients
+/// maps without a full gradient fall back to the per-brick gradients
 #define VOXEL_GRADIENT_FAST(v, x, y, z, grad) \
-  { int index = ((z)*v->xsize*v->ysize + (y)*v->xsize + (x)) * 3; \
-    (grad)[0] = v->gradient[index    ]; \
-    (grad)[1] = v->gradient[index + 1]; \
-    (grad)[2] = v->gradient[index + 2]; \
-  }
+  do { \
+    if (v->gradient) { \
+      int index = ((z)*v->xsize*v->ysize + (y)*v->xsize + (x)) * 3; \
+      (grad)[0] = v->gradient[index    ]; \
+      (grad)[1] = v->gradient[index + 1]; \
+      (grad)[2] = v->gradient[index + 2]; \
+    } else { \
+      v->brick_voxel_gradient((x), (y), (z), (grad)); \
+    } \
+  } while (0)
 
 #endif // VOLUMETRICDATA_H
@@ -21,6 +21,10 @@
 
 #include "msmpot_internal.h"
 
+#if defined(VMDTHREADS)
+#include "WKFThreads.h"
+#endif
+
 static int anterpolation(Msmpot *msm);
 static int interpolation_factored(Msmpot *msm);
 static int interpolation(Msmpot *msm);
@@ -28,9 +32,40 @@ static int restriction(Msmpot *msm, int level);
 static int prolongation(Msmpot *msm, int level);
 static int latticecutoff(Msmpot *msm, int level);
 
+static int anterpolation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd);
+static int interpolation_factored_slab(Msmpot *msm, int level,
+    int kfirst, int klast, float *zd, float *yzd);
+static int interpolation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd);
+static int latticecutoff_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd);
+
 #undef OK
 #define OK MSMPOT_SUCCESS
 
+
+/*
+ * Each stage below is written as a kernel over a range of planes or
+ * columns, [first,last], of the lattice it produces.  The ranges are
+ * independent, and within a range every lattice point accumulates its
+ * contributions in the same order as a single pass over the whole lattice
+ * would, so the results don't depend on how many threads are used.
+ *
+ * A kernel may be given two scratch buffers, sized per stage; the serial
+ * path passes the buffers kept in the Msmpot structure and each worker
+ * thread allocates its own, for the block of planes or columns it gets.
+ */
+typedef int (*slab_kernel)(Msmpot *msm, int level, int first, int last,
+    float *zd, float *yzd);
+
+static int run_slabs(Msmpot *msm, int level, slab_kernel kernel,
+    int first, int last, long work, long nzd, long nyzd, long nyzdplane,
+    float *zd, float *yzd);
+
+/* don't bother starting threads for less work than this per thread */
+#define MSMPOT_MIN_THREAD_WORK  65536
+
 /*
  * The factored grid transfers are faster O(p M) versus O(p^3 M).
  * The implementation here supports periodic boundaries.
@@ -149,8 +184,88 @@ int Msmpot_compute_longrng_cubic(Msmpot *msm) {
 
 int anterpolation(Msmpot *msm)
 {
+  const floatGrid *qhgrid = &(msm->qh[0]);
   const float *atom = msm->atom;
   const int natoms = msm->natoms;
+  const float hz_1 = 1/msm->hz;
+  const float zm0 = msm->pz0;
+  const int ka = qhgrid->k0;
+  const int nk = qhgrid->nk;
+  const int kb = ka + nk - 1;
+  int *first, *index;
+  float rz_hz;
+  int n, k, klo, err;
+
+  /* group the charged atoms by the lowest plane of their stencil, so a
+   * slab of qh planes only visits the atoms that reach it; atoms whose
+   * stencil wraps around the lattice go in an extra group after plane kb */
+  if (msm->max_plane_first < nk + 3) {
+    void *v = realloc(msm->plane_first, (nk + 3) * sizeof(int));
+    if (NULL == v) return ERROR(MSMPOT_ERROR_MALLOC);
+    msm->plane_first = (int *) v;
+    msm->max_plane_first = nk + 3;
+  }
+  if (msm->max_plane_atom < natoms) {
+    void *v = realloc(msm->plane_atom_index, natoms * sizeof(int));
+    if (NULL == v) return ERROR(MSMPOT_ERROR_MALLOC);
+    msm->plane_atom_index = (int *) v;
+    msm->max_plane_atom = natoms;
+  }
+  first = msm->plane_first;
+  index = msm->plane_atom_index;
+
+  /* counting sort, stable so atoms keep their order within each plane */
+  memset(first, 0, (nk + 3) * sizeof(int));
+  for (n = 0;  n < natoms;  n++) {
+    if (0==atom[4*n + 3]) continue;
+    rz_hz = (atom[4*n + 2] - zm0) * hz_1;
+    klo = (int) floorf(rz_hz) - 1;
+    k = (ka <= klo && klo + 3 <= kb ? klo - ka : nk);
+    first[k+2]++;
+  }
+  for (k = 2;  k < nk + 3;  k++) {
+    first[k] += first[k-1];
+  }
+  for (n = 0;  n < natoms;  n++) {
+    if (0==atom[4*n + 3]) continue;
+    rz_hz = (atom[4*n + 2] - zm0) * hz_1;
+    klo = (int) floorf(rz_hz) - 1;
+    k = (ka <= klo && klo + 3 <= kb ? klo - ka : nk);
+    index[ first[k+1]++ ] = n;
+  }
+  /* now plane k - ka has atoms first[k-ka] through first[k-ka+1]-1 */
+
+  err = run_slabs(msm, 0, anterpolation_slab, ka, kb,
+      64L * msm->natoms + qhgrid->ni * (long)qhgrid->nj * qhgrid->nk,
+      0, 0, 0, NULL, NULL);
+  if (err) return ERROR(err);
+
+#ifdef MSMPOT_DEBUG
+  {
+    const float *qh = qhgrid->data;
+    const int ni = qhgrid->ni;
+    const int nj = qhgrid->nj;
+    int i, j, k;
+    float qsum = 0;
+    for (k = qhgrid->k0;  k < qhgrid->k0 + qhgrid->nk;  k++) {
+      for (j = qhgrid->j0;  j < qhgrid->j0 + nj;  j++) {
+        for (i = qhgrid->i0;  i < qhgrid->i0 + ni;  i++) {
+          qsum += qh[(k*nj + j)*(long)ni + i];
+        }
+      }
+    }
+    printf("#  level = 0,  grid sum = %e\n", qsum);
+  }
+#endif
+  return OK;
+} /* anterpolation */
+
+
+/* spread atom charges onto qh planes kfirst through klast */
+int anterpolation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd)
+{
+  const float *atom = msm->atom;
 
   float xphi[4], yphi[4], zphi[4];  /* phi grid func along x, y, z */
   float rx_hx, ry_hy, rz_hz;        /* distance from origin */
@@ -185,138 +300,167 @@ int anterpolation(Msmpot *msm)
   const int ispany = IS_SET_ANY(msm->isperiodic);
   int iswrap;
 
-  int n, i, j, k, ilo, jlo, klo, koff;
-  long jkoff, index;
-
-  GRID_ZERO(qhgrid);
-
-  for (n = 0;  n < natoms;  n++) {
+  const int *plane_first = msm->plane_first;
+  const int *plane_atom = msm->plane_atom_index;
+  int mfirst, mlast, pass;
 
-    /* atomic charge */
-    q = atom[4*n + 3];
-    if (0==q) continue;
-
-    /* distance between atom and origin measured in grid points */
-    rx_hx = (atom[4*n    ] - xm0) * hx_1;
-    ry_hy = (atom[4*n + 1] - ym0) * hy_1;
-    rz_hz = (atom[4*n + 2] - zm0) * hz_1;
+  int m, n, i, j, k, ilo, jlo, klo, koff;
+  long jkoff, index;
 
-    /* find smallest numbered grid point in stencil */
-    ilo = (int) floorf(rx_hx) - 1;
-    jlo = (int) floorf(ry_hy) - 1;
-    klo = (int) floorf(rz_hz) - 1;
+  /* clear only the planes owned by this slab */
+  memset(qh + ((long)kfirst*nj + ja)*ni + ia, 0,
+      (klast - kfirst + 1) * (size_t)nj * ni * sizeof(float));
+
+  /* first the atoms with stencils starting on planes kfirst-3 to klast,
+   * then the atoms whose stencils wrap around the lattice */
+  for (pass = 0;  pass < 2;  pass++) {
+    if (0 == pass) {
+      int pfirst = (kfirst - 3 > ka ? kfirst - 3 : ka) - ka;
+      int plast = (klast < kb ? klast : kb) - ka;
+      mfirst = plane_first[pfirst];
+      mlast = plane_first[plast + 1];
+    }
+    else {
+      mfirst = plane_first[nk];
+      mlast = plane_first[nk + 1];
+    }
 
-    /* find t for x dimension and compute xphi */
-    t = rx_hx - (float) ilo;
-    xphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
-    t--;
-    xphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
-    t--;
-    xphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
-    t--;
-    xphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
-
-    /* find t for y dimension and compute yphi */
-    t = ry_hy - (float) jlo;
-    yphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
-    t--;
-    yphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
-    t--;
-    yphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
-    t--;
-    yphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
-
-    /* find t for z dimension and compute zphi */
-    t = rz_hz - (float) klo;
-    zphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
-    t--;
-    zphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
-    t--;
-    zphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
-    t--;
-    zphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
-
-    /* short-circuit tests for non-periodic boundaries */
-    iswrap = ispany &&
-      ( ilo < ia || (ilo+3) > ib ||
-        jlo < ja || (jlo+3) > jb ||
-        klo < ka || (klo+3) > kb);
-
-    if ( ! iswrap ) {
-      /* don't have to worry about wrapping */
-      ASSERT(ia <= ilo && ilo + 3 <= ib);
-      ASSERT(ja <= jlo && jlo + 3 <= jb);
-      ASSERT(ka <= klo && klo + 3 <= kb);
-
-      /* determine charge on 64=4*4*4 grid point stencil of qh */
-      for (k = 0;  k < 4;  k++) {
-        koff = (k + klo) * nj;
-        ck = zphi[k] * q;
-        for (j = 0;  j < 4;  j++) {
-          jkoff = (koff + (j + jlo)) * (long)ni;
-          cjk = yphi[j] * ck;
-          for (i = 0;  i < 4;  i++) {
-            index = jkoff + (i + ilo);
-            GRID_INDEX_CHECK(qhgrid, i+ilo, j+jlo, k+klo);
-            ASSERT(GRID_INDEX(qhgrid, i+ilo, j+jlo, k+klo) == index);
-            qh[index] += xphi[i] * cjk;
+    for (m = mfirst;  m < mlast;  m++) {
+      n = plane_atom[m];
+
+      /* atomic charge */
+      q = atom[4*n + 3];
+
+      /* distance between atom and origin measured in grid points */
+      rz_hz = (atom[4*n + 2] - zm0) * hz_1;
+      klo = (int) floorf(rz_hz) - 1;
+
+      rx_hx = (atom[4*n    ] - xm0) * hx_1;
+      ry_hy = (atom[4*n + 1] - ym0) * hy_1;
+
+      /* find smallest numbered grid point in stencil */
+      ilo = (int) floorf(rx_hx) - 1;
+      jlo = (int) floorf(ry_hy) - 1;
+
+      /* find t for x dimension and compute xphi */
+      t = rx_hx - (float) ilo;
+      xphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
+      t--;
+      xphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
+      t--;
+      xphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
+      t--;
+      xphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
+
+      /* find t for y dimension and compute yphi */
+      t = ry_hy - (float) jlo;
+      yphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
+      t--;
+      yphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
+      t--;
+      yphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
+      t--;
+      yphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
+
+      /* find t for z dimension and compute zphi */
+      t = rz_hz - (float) klo;
+      zphi[0] = 0.5f * (1 - t) * (2 - t) * (2 - t);
+      t--;
+      zphi[1] = (1 - t) * (1 + t - 1.5f * t * t);
+      t--;
+      zphi[2] = (1 + t) * (1 - t - 1.5f * t * t);
+      t--;
+      zphi[3] = 0.5f * (1 + t) * (2 + t) * (2 + t);
+
+      /* short-circuit tests for non-periodic boundaries */
+      iswrap = ispany &&
+        ( ilo < ia || (ilo+3) > ib ||
+          jlo < ja || (jlo+3) > jb ||
+          klo < ka || (klo+3) > kb);
+
+      if ( ! iswrap ) {
+        /* don't have to worry about wrapping */
+        ASSERT(ia <= ilo && ilo + 3 <= ib);
+        ASSERT(ja <= jlo && jlo + 3 <= jb);
+        ASSERT(ka <= klo && klo + 3 <= kb);
+
+        /* determine charge on 64=4*4*4 grid point stencil of qh */
+        for (k = 0;  k < 4;  k++) {
+          if (k + klo < kfirst || k + klo > klast) continue;
+          koff = (k + klo) * nj;
+          ck = zphi[k] * q;
+          for (j = 0;  j < 4;  j++) {
+            jkoff = (koff + (j + jlo)) * (long)ni;
+            cjk = yphi[j] * ck;
+            for (i = 0;  i < 4;  i++) {
+              index = jkoff + (i + ilo);
+              GRID_INDEX_CHECK(qhgrid, i+ilo, j+jlo, k+klo);
+              ASSERT(GRID_INDEX(qhgrid, i+ilo, j+jlo, k+klo) == index);
+              qh[index] += xphi[i] * cjk;
+            }
           }
         }
-      }
-    } /* if */
-    else {
-      int ip, jp, kp;
-
-      /* adjust ilo, jlo, klo so they are within lattice indexing */
-      if      (ilo < ia) do { ilo += ni; } while (ilo < ia);
-      else if (ilo > ib) do { ilo -= ni; } while (ilo > ib);
-      if      (jlo < ja) do { jlo += nj; } while (jlo < ja);
-      else if (jlo > jb) do { jlo -= nj; } while (jlo > jb);
-      if      (klo < ka) do { klo += nk; } while (klo < ka);
-      else if (klo > kb) do { klo -= nk; } while (klo > kb);
-
-      /* determine charge on 64=4*4*4 grid point stencil of qh */
-      for (k = 0, kp = klo;  k < 4;  k++, kp++) {
-        if (kp > kb) kp = ka;  /* wrap stencil around grid */
-        koff = kp * nj;
-        ck = zphi[k] * q;
-        for (j = 0, jp = jlo;  j < 4;  j++, jp++) {
-          if (jp > jb) jp = ja;  /* wrap stencil around grid */
-          jkoff = (koff + jp) * (long)ni;
-          cjk = yphi[j] * ck;
-          for (i = 0, ip = ilo;  i < 4;  i++, ip++) {
-            if (ip > ib) ip = ia;  /* wrap stencil around grid */
-            index = jkoff + ip;
-            GRID_INDEX_CHECK(qhgrid, ip, jp, kp);
-            ASSERT(GRID_INDEX(qhgrid, ip, jp, kp) == index);
-            qh[index] += xphi[i] * cjk;
+      } /* if */
+      else {
+        int ip, jp, kp;
+
+        /* adjust ilo, jlo, klo so they are within lattice indexing */
+        if      (ilo < ia) do { ilo += ni; } while (ilo < ia);
+        else if (ilo > ib) do { ilo -= ni; } while (ilo > ib);
+        if      (jlo < ja) do { jlo += nj; } while (jlo < ja);
+        else if (jlo > jb) do { jlo -= nj; } while (jlo > jb);
+        if      (klo < ka) do { klo += nk; } while (klo < ka);
+        else if (klo > kb) do { klo -= nk; } while (klo > kb);
+
+        /* determine charge on 64=4*4*4 grid point stencil of qh */
+        for (k = 0, kp = klo;  k < 4;  k++, kp++) {
+          if (kp > kb) kp = ka;  /* wrap stencil around grid */
+          if (kp < kfirst || kp > klast) continue;
+          koff = kp * nj;
+          ck = zphi[k] * q;
+          for (j = 0, jp = jlo;  j < 4;  j++, jp++) {
+            if (jp > jb) jp = ja;  /* wrap stencil around grid */
+            jkoff = (koff + jp) * (long)ni;
+            cjk = yphi[j] * ck;
+            for (i = 0, ip = ilo;  i < 4;  i++, ip++) {
+              if (ip > ib) ip = ia;  /* wrap stencil around grid */
+              index = jkoff + ip;
+              GRID_INDEX_CHECK(qhgrid, ip, jp, kp);
+              ASSERT(GRID_INDEX(qhgrid, ip, jp, kp) == index);
+              qh[index] += xphi[i] * cjk;
+            }
           }
         }
-      }
-    } /* else */
+      } /* else */
 
-  } /* end loop over atoms */
-#ifdef MSMPOT_DEBUG
-  ck = 0;
-  for (k = ka;  k <= kb;  k++) {
-    for (j = ja;  j <= jb;  j++) {
-      for (i = ia;  i <= ib;  i++) {
-        index = (k*nj + j)*(long)ni + i;
-        ck += qh[index];
-      }
-    }
-  }
-  printf("#  level = 0,  grid sum = %e\n", ck);
-#endif
+    } /* end loop over atoms */
+  } /* end loop over passes */
   return OK;
-} /* anterpolation */
+} /* anterpolation_slab */
 
 
 int interpolation_factored(Msmpot *msm) {
+  const floatGrid *ehgrid = &(msm->eh[0]);
+  int err;
+
+  /* each slab of map planes sweeps the whole eh lattice */
+  err = run_slabs(msm, 0, interpolation_factored_slab, 0, msm->mz - 1,
+      (long)msm->mx * msm->my * msm->mz * (2*msm->rmap_x + 1)
+      + ehgrid->ni * (long)ehgrid->nj * ehgrid->nk,
+      msm->mz, 0, msm->my, msm->ezd, msm->eyzd);
+  if (err) return ERROR(err);
+  return OK;
+} /* interpolation_factored() */
+
+
+/* add the interpolated eh potentials to epotmap planes kfirst to klast,
+ * zd is a buffer of length mz, yzd is a buffer of length my per plane */
+int interpolation_factored_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd) {
   float *epotmap = msm->epotmap;
 
-  float *ezd = msm->ezd;
-  float *eyzd = msm->eyzd;
+  float *ezd = zd;
+  float *eyzd = yzd - kfirst * (long)msm->my;  /* index by map plane */
 
   const floatGrid *ehgrid = &(msm->eh[0]);
   const float *eh = ehgrid->data;
@@ -337,8 +481,8 @@ int interpolation_factored(Msmpot *msm) {
   const int ispy = (IS_SET_Y(msm->isperiodic) != 0);
   const int ispz = (IS_SET_Z(msm->isperiodic) != 0);
 
-  const size_t size_ezd = mz * sizeof(float);
-  const size_t size_eyzd = my * mz * sizeof(float);
+  const size_t size_ezd = (klast - kfirst + 1) * sizeof(float);
+  const size_t size_eyzd = my * (size_t)(klast - kfirst + 1) * sizeof(float);
 
   const int ih_phi_cycle = msm->cycle_x;
   const int jh_phi_cycle = msm->cycle_y;
@@ -368,32 +512,45 @@ int interpolation_factored(Msmpot *msm) {
   int index_plane_eh, index_eh;
   int index_jk, offset_k;
   long offset;
+  int khfirst = ka, khlast = kb, kh_phi_first;
+
+  /* only eh planes whose stencil reaches the slab contribute to it;
+   * the stencils wrap around along periodic z, so there all are visited */
+  if ( ! ispz ) {
+    while (khfirst <= kb && (int) floorf(khfirst * hz_dz) + rmap_z < kfirst) {
+      khfirst++;
+    }
+    while (khlast >= khfirst && (int) floorf(khlast * hz_dz) - rmap_z > klast) {
+      khlast--;
+    }
+  }
 
   ih_phi = ia;
   while (ih_phi < 0) ih_phi += ih_phi_cycle;
   jh_phi = ja;
   while (jh_phi < 0) jh_phi += jh_phi_cycle;
-  kh_phi = ka;
-  while (kh_phi < 0) kh_phi += kh_phi_cycle;
+  kh_phi_first = khfirst % kh_phi_cycle;
+  if (kh_phi_first < 0) kh_phi_first += kh_phi_cycle;
 
   for (ih = ia;  ih <= ib;  ih++, ih_phi++) {
     if (ih_phi == ih_phi_cycle) ih_phi = 0;
-    memset(eyzd, 0, size_eyzd);
+    memset(eyzd + kfirst * (long)my, 0, size_eyzd);
 
     for (jh = ja;  jh <= jb;  jh++, jh_phi++) {
       if (jh_phi == jh_phi_cycle) jh_phi = 0;
-      memset(ezd, 0, size_ezd);
+      memset(ezd + kfirst, 0, size_ezd);
       index_plane_eh = jh * nrow_eh + ih;
 
-      for (kh = ka;  kh <= kb;  kh++, kh_phi++) {
+      kh_phi = kh_phi_first;
+      for (kh = khfirst;  kh <= khlast;  kh++, kh_phi++) {
         if (kh_phi == kh_phi_cycle) kh_phi = 0;
         index_eh = kh * nstride_eh + index_plane_eh;
         km = (int) floorf(kh * hz_dz);
         if ( ! ispz ) {  /* nonperiodic */
           int lower = km - rmap_z;
           int upper = km + rmap_z;
-          if (lower < 0)   lower = 0;
-          if (upper >= mz) upper = mz-1;  /* clip upper and lower */
+          if (lower < kfirst) lower = kfirst;
+          if (upper > klast)  upper = klast;  /* clip to slab */
           phi = base_phi_z + diam_z * kh_phi + rmap_z;
           for (k = lower;  k <= upper;  k++) {
             ezd[k] += phi[k-km] * eh[index_eh];
@@ -405,12 +562,13 @@ int interpolation_factored(Msmpot *msm) {
           phi = base_phi_z + diam_z * kh_phi;
           for (k = 0;  k < diam_z;  k++, kp++) {
             if (kp == mz) kp -= mz;  /* wrap kp */
+            if (kp < kfirst || kp > klast) continue;
             ezd[kp] += phi[k] * eh[index_eh];
           }
         }
       }
 
-      for (k = 0;  k < mz;  k++) {
+      for (k = kfirst;  k <= klast;  k++) {
         offset = k * my;
         jm = (int) floorf(jh * hy_dy);
         if ( ! ispy ) {  /* nonperiodic */
@@ -435,7 +593,7 @@ int interpolation_factored(Msmpot *msm) {
       }
     }
 
-    for (k = 0;  k < mz;  k++) {
+    for (k = kfirst;  k <= klast;  k++) {
       offset_k = k * my;
 
       for (j = 0;  j < my;  j++) {
@@ -466,10 +624,23 @@ int interpolation_factored(Msmpot *msm) {
 
   }
   return OK;
-} /* interpolation_factored() */
+} /* interpolation_factored_slab() */
 
 
 int interpolation(Msmpot *msm)
+{
+  int err;
+
+  err = run_slabs(msm, 0, interpolation_slab, 0, msm->mz - 1,
+      64L * msm->mx * msm->my * msm->mz, 0, 0, 0, NULL, NULL);
+  if (err) return ERROR(err);
+  return OK;
+} /* interpolation() */
+
+
+/* add the interpolated eh potentials to epotmap planes kfirst to klast */
+int interpolation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd)
 {
   float *epotmap = msm->epotmap;
 
@@ -486,7 +657,6 @@ int interpolation(Msmpot *msm)
 
   const int mx = msm->mx;
   const int my = msm->my;
-  const int mz = msm->mz;
   const float dx = msm->dx;
   const float dy = msm->dy;
   const float dz = msm->dz;
@@ -515,7 +685,7 @@ int interpolation(Msmpot *msm)
   int koff, kmoff;
   long index, mindex, jkoff, jkmoff;
 
-  for (kk = 0;  kk < mz;  kk++) {
+  for (kk = kfirst;  kk <= klast;  kk++) {
     kmoff = kk * my;
     z = kk*dz + lz0;
 
@@ -641,7 +811,7 @@ int interpolation(Msmpot *msm)
   } /* end map loop */
 
   return OK;
-} /* interpolation() */
+} /* interpolation_slab() */
 
 
 #if !defined(USE_FACTORED_GRID_TRANSFERS)
@@ -853,8 +1023,47 @@ static const float PHI_FACTORED[DIAM_STENCIL] = {
   -0.0625f, 0, 0.5625f, 1, 0.5625f, 0, -0.0625f
 };
 
+static int restriction_slab(Msmpot *msm, int level, int i2first, int i2last,
+    float *zd, float *yzd);
+static int prolongation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd);
+
 
 int restriction(Msmpot *msm, int level) {
+  const floatGrid *qhgrid = &(msm->qh[level]);
+  const floatGrid *q2hgrid = &(msm->qh[level+1]);
+  int err;
+
+  /* columns of q2h are independent, each one needs a yz plane of scratch */
+  err = run_slabs(msm, level, restriction_slab,
+      q2hgrid->i0, q2hgrid->i0 + q2hgrid->ni - 1,
+      DIAM_STENCIL * (long)q2hgrid->ni * qhgrid->nj * qhgrid->nk,
+      qhgrid->nk, qhgrid->nj * (long)qhgrid->nk, 0, msm->lzd, msm->lyzd);
+  if (err) return ERROR(err);
+
+#ifdef MSMPOT_DEBUG
+  {
+    const float *q2h = q2hgrid->data;
+    int i, j, k;
+    float qsum = 0;
+    for (k = q2hgrid->k0;  k < q2hgrid->k0 + q2hgrid->nk;  k++) {
+      for (j = q2hgrid->j0;  j < q2hgrid->j0 + q2hgrid->nj;  j++) {
+        for (i = q2hgrid->i0;  i < q2hgrid->i0 + q2hgrid->ni;  i++) {
+          qsum += q2h[(k*q2hgrid->nj + j)*(long)q2hgrid->ni + i];
+        }
+      }
+    }
+    printf("#  level = %d,  grid sum = %e\n", level+1, qsum);
+  }
+#endif
+  return OK;
+} /* restriction, factored */
+
+
+/* restrict qh onto q2h columns i2first through i2last,
+ * zd is a buffer of length nk, yzd has length nj*nk of the finer grid */
+int restriction_slab(Msmpot *msm, int level, int i2first, int i2last,
+    float *zd, float *yzd) {
   /* lattices of potential, finer grid and coarser grid */
   const floatGrid *qhgrid = &(msm->qh[level]);
   const float *qh = qhgrid->data;
@@ -873,8 +1082,6 @@ int restriction(Msmpot *msm, int level) {
   const int nk1 = qhgrid->nk;             /* length along z-dim */
 
   /* coarser grid index ranges and dimensions */
-  const int ia2 = q2hgrid->i0;            /* lowest x-index */
-  const int ib2 = ia2 + q2hgrid->ni - 1;  /* highest x-index */
   const int ja2 = q2hgrid->j0;            /* lowest y-index */
   const int jb2 = ja2 + q2hgrid->nj - 1;  /* highest y-index */
   const int ka2 = q2hgrid->k0;            /* lowest z-index */
@@ -887,8 +1094,8 @@ int restriction(Msmpot *msm, int level) {
   const int ispz = (IS_SET_Z(msm->isperiodic) != 0);
 
   /* set buffer using indexing offset, so that indexing matches qh grid */
-  float *qzd = msm->lzd + (-ka1);
-  float *qyzd = msm->lyzd + (-ka1*nj1 + -ja1);
+  float *qzd = zd + (-ka1);
+  float *qyzd = yzd + (-ka1*nj1 + -ja1);
   float qsum;
 
   const float *phi = NULL;
@@ -900,7 +1107,7 @@ int restriction(Msmpot *msm, int level) {
   int index_jk, offset_k;
   long offset;
 
-  for (i2 = ia2;  i2 <= ib2;  i2++) {
+  for (i2 = i2first;  i2 <= i2last;  i2++) {
 
     for (k = ka1;  k <= kb1;  k++) {
       offset_k = k * nj1;
@@ -992,23 +1199,29 @@ int restriction(Msmpot *msm, int level) {
     } /* for j2 */
 
   } /* for i2 */
-#ifdef MSMPOT_DEBUG
-  qsum = 0;
-  for (k = ka2;  k <= kb2;  k++) {
-    for (j = ja2;  j <= jb2;  j++) {
-      for (i = ia2;  i <= ib2;  i++) {
-        index_q2 = k*nstride_q2 + j*nrow_q2 + i;
-        qsum += q2h[index_q2];
-      }
-    }
-  }
-  printf("#  level = %d,  grid sum = %e\n", level+1, qsum);
-#endif
   return OK;
-} /* restriction, factored */
+} /* restriction_slab, factored */
 
 
 int prolongation(Msmpot *msm, int level) {
+  const floatGrid *ehgrid = &(msm->eh[level]);
+  const floatGrid *e2hgrid = &(msm->eh[level+1]);
+  int err;
+
+  /* neighboring e2h columns overlap on eh, so split by eh planes instead */
+  err = run_slabs(msm, level, prolongation_slab,
+      ehgrid->k0, ehgrid->k0 + ehgrid->nk - 1,
+      DIAM_STENCIL * (long)e2hgrid->ni * ehgrid->nj * ehgrid->nk,
+      ehgrid->nk, 0, ehgrid->nj, msm->lzd, msm->lyzd);
+  if (err) return ERROR(err);
+  return OK;
+} /* prolongation, factored */
+
+
+/* add the e2h potentials interpolated onto eh planes kfirst through klast,
+ * zd is a buffer of length nk, yzd has length nj per plane of the finer grid */
+int prolongation_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd) {
   /* lattices of potential, finer grid and coarser grid */
   floatGrid *ehgrid = &(msm->eh[level]);
   float *eh = ehgrid->data;
@@ -1041,11 +1254,11 @@ int prolongation(Msmpot *msm, int level) {
   const int ispz = (IS_SET_Z(msm->isperiodic) != 0);
 
   /* set buffer using indexing offset, so that indexing matches eh grid */
-  float *ezd = msm->lzd + (-ka1);
-  float *eyzd = msm->lyzd + (-ka1*nj1 + -ja1);
+  float *ezd = zd + (-ka1);
+  float *eyzd = yzd + (-kfirst*nj1 + -ja1);
 
-  const size_t size_lzd = nk1 * sizeof(float);
-  const size_t size_lyzd = nj1 * nk1 * sizeof(float);
+  const size_t size_lzd = (klast - kfirst + 1) * sizeof(float);
+  const size_t size_lyzd = nj1 * (size_t)(klast - kfirst + 1) * sizeof(float);
 
   const float *phi = NULL;
 
@@ -1055,22 +1268,30 @@ int prolongation(Msmpot *msm, int level) {
   int index_plane_e2, index_e2;
   int index_jk, offset_k;
   long offset;
+  int k2first = ka2, k2last = kb2;
+
+  /* only e2h planes whose stencil reaches the slab contribute to it;
+   * the stencils wrap around along periodic z, so there all are visited */
+  if ( ! ispz ) {
+    while (k2first <= kb2 && 2*k2first + R_STENCIL < kfirst) k2first++;
+    while (k2last >= k2first && 2*k2last - R_STENCIL > klast) k2last--;
+  }
 
   for (i2 = ia2;  i2 <= ib2;  i2++) {
-    memset(msm->lyzd, 0, size_lyzd);
+    memset(yzd, 0, size_lyzd);
 
     for (j2 = ja2;  j2 <= jb2;  j2++) {
-      memset(msm->lzd, 0, size_lzd);
+      memset(ezd + kfirst, 0, size_lzd);
       index_plane_e2 = j2 * nrow_e2 + i2;
 
-      for (k2 = ka2;  k2 <= kb2;  k2++) {
+      for (k2 = k2first;  k2 <= k2last;  k2++) {
         index_e2 = k2 * nstride_e2 + index_plane_e2;
         km = (k2 << 1);  /* = 2*k2 */
         if ( ! ispz ) {  /* nonperiodic */
           int lower = km - R_STENCIL;
           int upper = km + R_STENCIL;
-          if (lower < ka1) lower = ka1;
-          if (upper > kb1) upper = kb1;  /* clip edges */
+          if (lower < kfirst) lower = kfirst;
+          if (upper > klast)  upper = klast;  /* clip to slab */
           phi = PHI_FACTORED + R_STENCIL;  /* center of stencil */
           for (k = lower;  k <= upper;  k++) {
             ezd[k] += phi[k-km] * e2h[index_e2];
@@ -1082,12 +1303,13 @@ int prolongation(Msmpot *msm, int level) {
           phi = PHI_FACTORED;  /* left end of stencil */
           for (k = 0;  k < DIAM_STENCIL;  k++, kp++) {
             if (kp > kb1) kp = ka1;  /* wrap around edge of lattice */
+            if (kp < kfirst || kp > klast) continue;
             ezd[kp] += phi[k] * e2h[index_e2];
           }
         }
       } /* for k2 */
 
-      for (k = ka1;  k <= kb1;  k++) {
+      for (k = kfirst;  k <= klast;  k++) {
         offset = k * nj1;
         jm = (j2 << 1);  /* = 2*j2 */
         if ( ! ispy ) {  /* nonperiodic */
@@ -1113,7 +1335,7 @@ int prolongation(Msmpot *msm, int level) {
 
     } /* for j2 */
 
-    for (k = ka1;  k <= kb1;  k++) {
+    for (k = kfirst;  k <= klast;  k++) {
       offset_k = k * nj1;
 
       for (j = ja1;  j <= jb1;  j++) {
@@ -1146,12 +1368,30 @@ int prolongation(Msmpot *msm, int level) {
   } /* for i2 */
 
   return OK;
-} /* prolongation, factored */
+} /* prolongation_slab, factored */
 
 #endif
 
 
 int latticecutoff(Msmpot *msm, int level)
+{
+  const floatGrid *qhgrid = &(msm->qh[level]);
+  const floatGrid *gcgrid = &(msm->gc[level]);
+  int err;
+
+  err = run_slabs(msm, level, latticecutoff_slab,
+      qhgrid->k0, qhgrid->k0 + qhgrid->nk - 1,
+      qhgrid->ni * (long)qhgrid->nj * qhgrid->nk
+      * (gcgrid->ni * (long)gcgrid->nj * gcgrid->nk),
+      0, 0, 0, NULL, NULL);
+  if (err) return ERROR(err);
+  return OK;
+}
+
+
+/* sum the weighted charge within the cutoff for eh planes kfirst to klast */
+int latticecutoff_slab(Msmpot *msm, int level, int kfirst, int klast,
+    float *zd, float *yzd)
 {
   float eh_sum;
 
@@ -1201,8 +1441,8 @@ int latticecutoff(Msmpot *msm, int level)
 
   if ( ispnone ) {  /* nonperiodic boundaries */
 
-    /* loop over all grid points */
-    for (k = ka;  k <= kb;  k++) {
+    /* loop over all grid points in the slab */
+    for (k = kfirst;  k <= klast;  k++) {
 
       /* clip gc ranges to keep offset for k index within grid */
       gka_clip = (k + gka < ka ? ka - k : gka);
@@ -1264,8 +1504,8 @@ int latticecutoff(Msmpot *msm, int level)
     int ilo, jlo, klo;
     int ip, jp, kp;
 
-    /* loop over all grid points */
-    for (k = ka;  k <= kb;  k++) {
+    /* loop over all grid points in the slab */
+    for (k = kfirst;  k <= klast;  k++) {
       klo = k + gka;
       if ( ! ispz ) {  /* nonperiodic z */
         /* clip gc ranges to keep offset for k index within grid */
@@ -1359,3 +1599,91 @@ int latticecutoff(Msmpot *msm, int level)
 
   return OK;
 }
+
+
+#if defined(VMDTHREADS)
+typedef struct {
+  Msmpot *msm;
+  int level;
+  slab_kernel kernel;
+  int first;            /* index of the plane or column for tile 0 */
+  int tilesize;         /* planes or columns handed to a thread at once */
+  long nzd, nyzd;       /* per-thread scratch buffer lengths */
+} slabparms;
+
+static void * slabthread(void *voidparms) {
+  slabparms *parms = NULL;
+  float *zd = NULL;
+  float *yzd = NULL;
+  wkf_tasktile_t tile;
+
+  wkf_threadlaunch_getdata(voidparms, (void **) &parms);
+
+  if ((parms->nzd > 0 &&
+        NULL == (zd = (float *) malloc(parms->nzd * sizeof(float)))) ||
+      (parms->nyzd > 0 &&
+        NULL == (yzd = (float *) malloc(parms->nyzd * sizeof(float))))) {
+    wkf_threadlaunch_setfatalerror(voidparms);
+    free(zd);
+    return NULL;
+  }
+
+  /* each thread takes a contiguous block of planes or columns */
+  while (wkf_threadlaunch_next_tile(voidparms, parms->tilesize, &tile)
+      != WKF_SCHED_DONE) {
+    if (parms->kernel(parms->msm, parms->level, parms->first + tile.start,
+          parms->first + tile.end - 1, zd, yzd) != OK) {
+      wkf_threadlaunch_setfatalerror(voidparms);
+      break;
+    }
+  }
+
+  free(zd);
+  free(yzd);
+  return NULL;
+}
+#endif
+
+
+/*
+ * Run a stage kernel over planes or columns first through last.
+ * The work estimate decides how many threads are worth starting;
+ * small (coarse level) lattices are done serially with the given buffers,
+ * otherwise each thread gets a contiguous block of planes or columns and
+ * allocates nzd floats of scratch space for zd, and for yzd nyzd floats
+ * plus nyzdplane floats for each plane or column in its block.
+ */
+int run_slabs(Msmpot *msm, int level, slab_kernel kernel,
+    int first, int last, long work, long nzd, long nyzd, long nyzdplane,
+    float *zd, float *yzd) {
+#if defined(VMDTHREADS)
+  int nslabs = last - first + 1;
+  long maxprocs = work / MSMPOT_MIN_THREAD_WORK;
+  int numprocs = wkf_thread_numprocessors();
+  if (numprocs > nslabs) numprocs = nslabs;
+  if (numprocs > maxprocs) numprocs = (int) maxprocs;
+
+  if (numprocs > 1) {
+    slabparms parms;
+    wkf_tasktile_t tile;
+
+    parms.msm = msm;
+    parms.level = level;
+    parms.kernel = kernel;
+    parms.first = first;
+    parms.tilesize = (nslabs + numprocs - 1) / numprocs;
+    parms.nzd = nzd;
+    parms.nyzd = nyzd + nyzdplane * parms.tilesize;
+
+    tile.start = 0;
+    tile.end = nslabs;
+    if (wkf_threadlaunch(numprocs, &parms, slabthread, &tile)) {
+      return ERROR(MSMPOT_ERROR_MALLOC);
+    }
+    return OK;
+  }
+#endif
+
+  if (last < first) return OK;
+  return kernel(msm, level, first, last, zd, yzd);
+}
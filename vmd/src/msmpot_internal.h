@@ -307,6 +307,11 @@ extern "C" {
     int *first_atom_index;             /* length maxcells >= ncells */
     int *next_atom_index;              /* length maxatoms >= natoms */
 
+    /* anterpolation visits atoms grouped by lowest qh plane of stencil */
+    int max_plane_atom, max_plane_first;  /* alloc lengths */
+    int *plane_atom_index;  /* charged atoms in plane order, length natoms */
+    int *plane_first;       /* start of each plane in list, length nk+3 */
+
 #ifdef MSMPOT_CUDA
     MsmpotCuda *msmcuda;    /* handle to "MsmpotCuda" (CUDA-compute) object */
     const int *devlist;     /* list of devices, prioritized highest to lowest */
@@ -149,6 +149,8 @@ void Msmpot_cleanup(Msmpot *msm) {
 
   free(msm->first_atom_index);
   free(msm->next_atom_index);
+  free(msm->plane_atom_index);
+  free(msm->plane_first);
 
   free(msm->bin);
   free(msm->bincount);